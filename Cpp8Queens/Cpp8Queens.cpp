@@ -1,25 +1,72 @@
 // Cpp8Queens.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <algorithm>
 #include <chrono>
 #include <ctype.h>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <immintrin.h>
 
 #include "queens.h"
+#include "baseline.h"
+#include "bit_queens.h"
+#include "batch_queries.h"
+#include "benchmark.h"
+#include "explicit_solution.h"
+#include "fingerprint.h"
+#include "first_solutions.h"
+#include "golden.h"
 #include "high_res_clock.h"
+#include "min_conflicts.h"
+#include "partial_board.h"
+#include "query_service.h"
+#include "board_map.h"
+#include "simd_queens.h"
 #include "sixteen_queens_common.h"
 #include "sixteen_queens.h"
 #include "sixteen_queens_avx2.h"
 #include "sixteen_queens_avx2_mt.h"
+#include "solution_stream.h"
+#include "solution_index.h"
 
 /*
 Command line arguments:
 -v   verbose
 -t   test
+-g [n] golden self test: every engine counts every board size it supports (up to n), exit code 1 on a wrong count
+-f   fingerprint every solution set; with -g, check every engine's against the 256 bits reference engine
+-o file n  write every solution for an n by n board to file, packed (8 bytes each), with the fastest engine available
+-e file n  write one solution for an n by n board (4 to 10^8) to file, 4 bytes a row, from a formula: no search.
+     Read back and checked.
+-q n "cells"  completions of a partial n by n board (up to 16): cells like q3,0 for a queen on row 3, column 0,
+     x5,5 for a cell where no queen may go, separated by spaces. Counts them, and shows the first few.
+-y [q] batch throughput: q random completion queries (default 100'000, 10x10 to 16x16, 5 to 7 queens placed),
+     counted and then first solutions only, in queries per second
+-d [socket] serve requests until quit, one per line (count n, solution n k, complete n cells, stats, quit), from stdin
+     or a Unix socket (any number of clients; quit from a client closes its connection, quit on stdin or a signal stops
+     the server); answers cached in queens_cache.txt, kept between runs
+-z   with -o, compress: each solution as the prefix it shares with an earlier one, plus the rest (2.5 to 5 times smaller)
+-u n [k]   the k-th solution (from 0, lexicographic order; random if no k) for an n by n board, and its rank back.
+     Uses queens_index_n.bin, built and saved the first time.
+-k n [k]   the first k solutions (default 1) for an n by n board, 4 to 64; stops as soon as it has them
+-n n [seed] one solution for an n by n board, n as big as memory allows (10^6 takes about a second), by local search
+-x [n] transposition table study, bit masks engine: nodes, hit rates and times for n = 12 up to n (default 15),
+     caching the last 0, 2, 3, 4 and 5 columns
+-l [k] bit masks engine: count the last k columns (3 to 5, default 4) from a table of every way of filling them
+-m   microbenchmarks of the kernels (threaten, is_totally_under_threat, not_threatened_rows) of every engine
 -s n short(n) - try only N different solutions, showing failures
+-c file  write the benchmark statistics to file, as CSV
+-j file  write the benchmark statistics to file, as JSON
+-b file  save the benchmark statistics, and the machine they ran on, as a baseline
+-r file  compare against a saved baseline; exit code 1 if anything got significantly slower
 
 */
 
@@ -28,27 +75,383 @@ using microsecs_t = double;
 enum class solution_type
 {
     sixty_four_standard,
+    sixty_four_bmi2,
     avx2_multi_threaded,
     avx2_single_threaded,
-    two_fifty_six_standard
+    two_fifty_six_standard,
+    bit_masks,
+    simd_scalar,
+    simd_sse2,
+    simd_avx512
 };
 
-// Template lambdas require an argument. Old fashioned is good.
-template<typename Solver, typename durations_t>
-void run(durations_t& durations, int first_size, int end_size, solution_type sol_type)
+// Every engine the benchmark knows about. The harness drives them all the same way.
+struct engine
 {
-    for (int desired_board_size = first_size; desired_board_size < end_size; ++desired_board_size)
+    const char* name;
+    solution_type sol_type;
+    int first_size;
+    int end_size;
+    bool requires_avx2;
+    bool requires_bmi2;
+    bool requires_avx512;
+    void (*set_board_size)(int);
+    bench::trial (*run_trial)();
+    golden::count_fn count;
+    void (*set_fingerprint)(bool);
+    golden::fingerprint_fn fingerprint;
+    void (*set_output)(packed::writer*);
+};
+
+static const engine engines[] = {
+    { "64 bits", solution_type::sixty_four_standard, 4, 9, false, false, false, &qns::solver::set_board_size, &qns::solver::run_trial, &qns::solver::count,
+        &qns::solver::set_fingerprint, &qns::solver::fingerprint, &qns::solver::set_output },
+    { "64 bits BMI2", solution_type::sixty_four_bmi2, 4, 9, false, true, false, &qns::solver::set_board_size, &qns::solver::run_trial_bmi2, &qns::solver::count_bmi2,
+        &qns::solver::set_fingerprint, &qns::solver::fingerprint, &qns::solver::set_output },
+    // I have four cores, no point trying under 8.
+    { "AVX2 multithreaded", solution_type::avx2_multi_threaded, 8, 17, true, false, false, &qns16avx2mt::solver::set_board_size, &qns16avx2mt::solver::run_trial, &qns16avx2mt::solver::count,
+        &qns16avx2mt::solver::set_fingerprint, &qns16avx2mt::solver::fingerprint, &qns16avx2mt::solver::set_output },
+    // SIMD search on the AVX2 backend, under the name the baselines know it by.
+    { "AVX2", solution_type::avx2_single_threaded, 4, 17, true, false, false, &qns16avx2::solver::set_board_size, &qns16avx2::solver::run_trial, &qns16avx2::solver::count,
+        &qns16avx2::solver::set_fingerprint, &qns16avx2::solver::fingerprint, &qns16avx2::solver::set_output },
+    // Reference: support 16 by 16 without using AVX2.
+    { "256 bits", solution_type::two_fifty_six_standard, 4, 17, false, false, false, &qns16::solver::set_board_size, &qns16::solver::run_trial, &qns16::solver::count,
+        &qns16::solver::set_fingerprint, &qns16::solver::fingerprint, &qns16::solver::set_output },
+    // Three masks per column, no maps.
+    { "Bit masks", solution_type::bit_masks, 4, 17, false, false, false, &qnsbits::solver::set_board_size, &qnsbits::solver::run_trial, &qnsbits::solver::count,
+        &qnsbits::solver::set_fingerprint, &qnsbits::solver::fingerprint, &qnsbits::solver::set_output },
+    // One search, written against board_map.h, on each instruction set.
+    { "SIMD scalar", solution_type::simd_scalar, 4, 17, false, false, false, &qnssimd::solver<simd::scalar>::set_board_size, &qnssimd::solver<simd::scalar>::run_trial,
+        &qnssimd::solver<simd::scalar>::count, &qnssimd::solver<simd::scalar>::set_fingerprint, &qnssimd::solver<simd::scalar>::fingerprint, &qnssimd::solver<simd::scalar>::set_output },
+    { "SIMD SSE2", solution_type::simd_sse2, 4, 17, false, false, false, &qnssimd::solver<simd::sse2>::set_board_size, &qnssimd::solver<simd::sse2>::run_trial,
+        &qnssimd::solver<simd::sse2>::count, &qnssimd::solver<simd::sse2>::set_fingerprint, &qnssimd::solver<simd::sse2>::fingerprint, &qnssimd::solver<simd::sse2>::set_output },
+    { "SIMD AVX-512", solution_type::simd_avx512, 4, 17, true, false, true, &qnssimd::solver<simd::avx512>::set_board_size, &qnssimd::solver<simd::avx512>::run_trial,
+        &qnssimd::solver<simd::avx512>::count, &qnssimd::solver<simd::avx512>::set_fingerprint, &qnssimd::solver<simd::avx512>::fingerprint, &qnssimd::solver<simd::avx512>::set_output },
+};
+
+template<typename durations_t>
+void run(durations_t& durations, std::vector<bench::statistics>& all_stats, const engine& eng, bool fingerprints)
+{
+    for (int desired_board_size = eng.first_size; desired_board_size < eng.end_size; ++desired_board_size)
     {
-        Solver::set_board_size(desired_board_size);
-        microsecs_t median_duration = Solver::solve();
-        durations[desired_board_size][sol_type] = median_duration;
+        eng.set_board_size(desired_board_size);
+        tsc::reset_phases();
+        const bench::statistics stats = bench::measure(eng.name, desired_board_size, eng.run_trial);
+        bench::print(stats);
+        tsc::print_phases(); // all trials of this size. The multithreaded engine's workers count as its search.
+        if (fingerprints)
+        {
+            // Half a board, with the mirror images: the same for every engine.
+            std::cout << "Fingerprint: " << eng.fingerprint().to_string() << std::endl;
+        }
+        durations[desired_board_size][eng.sol_type] = stats.p50;
+        all_stats.push_back(stats);
     }
 };
 
+// Solver objects, one board size per thread, all at the same time. They share nothing, so the counts must not change.
+static int check_instances(int max_board_size)
+{
+    const int last_size = std::min(max_board_size, golden::last_known_size);
+    std::vector<unsigned long long> totals(size_t(last_size) + 1, 0);
+    std::vector<double> milliseconds(size_t(last_size) + 1, 0.0);
+    std::vector<std::thread> threads;
+    for (int board_size = golden::first_known_size; board_size <= last_size; ++board_size)
+    {
+        threads.emplace_back([board_size, &totals, &milliseconds] {
+            hi_res_timer timer;
+            qnssimd::instance<simd::sse2> solver(board_size);
+            totals[board_size] = solver.total();
+            milliseconds[board_size] = timer.GetElapsedMicroseconds() / 1000.0;
+        });
+    }
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    int failures = 0;
+    for (int board_size = golden::first_known_size; board_size <= last_size; ++board_size)
+    {
+        const bool pass = (totals[board_size] == golden::expected(board_size));
+        failures += pass ? 0 : 1;
+        std::cout << std::format("{} {:<20} n = {:2}: {:10} solutions{} ({:.1f} ms, concurrently)", pass ? "PASS" : "FAIL", "Solver objects",
+            board_size, totals[board_size], pass ? "" : ", expected " + std::to_string(golden::expected(board_size)), milliseconds[board_size]) << std::endl;
+    }
+    return failures;
+}
+
+// How much a transposition table saves, and what it costs, depending on how many columns it caches.
+static int run_memo_study(int max_board_size)
+{
+    const int memo_columns[] = { 0, 2, 3, 4, 5 };
+    // The table only caches counts: with -f or -o every row would run without it. Sizes above 16 could not be folded anyway.
+    qnsbits::solver::set_fingerprint(false);
+    qnsbits::solver::set_output(nullptr);
+    std::cout << "Size, Memo columns,          Nodes,  Cut,        Lookups, Hit rate,   Evictions, Table (KB),   Time (ms)" << std::endl;
+    for (int board_size = 12; board_size <= max_board_size; ++board_size)
+    {
+        qnsbits::solver::set_board_size(board_size);
+        unsigned long long nodes_without = 0;
+        for (int columns : memo_columns)
+        {
+            qnsbits::solver::set_memo(columns);
+            const bench::trial t = qnsbits::solver::run_trial();
+            const unsigned long long nodes = qnsbits::solver::nodes();
+            if (columns == 0)
+            {
+                nodes_without = nodes;
+            }
+            const memo::table::statistics stats = qnsbits::solver::memo_statistics();
+            std::cout << std::format("{:4}, {:12}, {:14}, {:3.0f}%, {:14}, {:7.1f}%, {:11}, {:10}, {:11.3f}",
+                board_size, columns, nodes, 100.0 - 100.0 * double(nodes) / double(nodes_without),
+                stats.lookups, stats.lookups ? 100.0 * double(stats.hits) / double(stats.lookups) : 0.0,
+                stats.evictions, qnsbits::solver::memo_bytes() / 1024, t.microseconds / 1000.0) << std::endl;
+        }
+    }
+    qnsbits::solver::set_memo(0);
+    return 0;
+}
+
+// A few solutions, fast, for boards too big to count. Each one is checked.
+static int run_first(int board_size, int wanted)
+{
+    const qnsfirst::result found = qnsfirst::find_first(board_size, wanted);
+    int invalid = 0;
+    for (const std::vector<int>& rows : found.solutions)
+    {
+        const bool valid = qnsfirst::is_solution(rows);
+        invalid += valid ? 0 : 1;
+        for (int row : rows)
+        {
+            std::cout << row << " ";
+        }
+        std::cout << (valid ? "" : " NOT A SOLUTION") << std::endl;
+    }
+    std::cout << found.solutions.size() << " of " << wanted << " solutions for n = " << board_size << ", "
+        << found.nodes << " queens placed, in " << found.microseconds / 1000.0 << " ms." << std::endl;
+    return (invalid || found.solutions.empty()) ? 1 : 0;
+}
+
+// One solution for a board of any size, by min-conflicts local search, checked independently.
+static int run_local_search(int board_size, bool random_seed, uint64_t seed)
+{
+    if (random_seed)
+    {
+        seed = std::random_device()();
+    }
+    const qnsmc::result found = qnsmc::solve(board_size, seed);
+    const bool valid = found.solved && qnsfirst::is_solution(found.rows);
+    if (board_size <= qnsfirst::maximum_allowed_board_size)
+    {
+        for (int row : found.rows)
+        {
+            std::cout << row << " ";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << (valid ? "Solved" : "FAILED") << " n = " << board_size << ", seed " << seed << ": " << found.moves << " moves, "
+        << found.restarts << " restarts, in " << found.microseconds / 1000.0 << " ms." << std::endl;
+    return valid ? 0 : 1;
+}
+
+// One solution, from the formula, written a row at a time and checked from the file.
+static int run_explicit(const char* path, int board_size)
+{
+    if (board_size < 4 || uint32_t(board_size) > qnsexplicit::maximum_allowed_board_size)
+    {
+        std::cout << "Size must be between 4 and " << qnsexplicit::maximum_allowed_board_size << ", it is " << board_size << "." << std::endl;
+        return 1;
+    }
+    hi_res_timer write_timer;
+    try
+    {
+        qnsexplicit::write(path, uint32_t(board_size));
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Cannot write " << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+    write_timer.Stop();
+    hi_res_timer verify_timer;
+    const packed::mapped_solutions written(path);
+    const bool valid = written.coding() == packed::encoding::wide_rows && written.size() == 1
+        && qnsexplicit::verify(written.rows(), uint32_t(written.board_size()));
+    verify_timer.Stop();
+    std::cout << (valid ? "Valid" : "INVALID") << " solution for n = " << board_size << " in " << path << ": written in "
+        << write_timer.GetElapsedMicroseconds() / 1000.0 << " ms, checked in " << verify_timer.GetElapsedMicroseconds() / 1000.0 << " ms." << std::endl;
+    return valid ? 0 : 1;
+}
+
+// Completions of a partial board, on the widest SIMD engine the machine has.
+static int run_completion(int board_size, const char* cells, bool has_avx2)
+{
+    if (board_size < 4 || board_size > simd::map_rows)
+    {
+        std::cout << "Size must be between 4 and " << simd::map_rows << ", it is " << board_size << "." << std::endl;
+        return 1;
+    }
+    partial::board board;
+    board.board_size = board_size;
+    std::istringstream tokens(cells);
+    std::string token;
+    while (tokens >> token)
+    {
+        char kind = 0;
+        partial::cell cell{ -1, -1 };
+        if (!partial::parse_cell(token, kind, cell))
+        {
+            std::cout << "Cannot read " << token << ": expected q<row>,<column> or x<row>,<column>, rows and columns 0 to "
+                << partial::maximum_coordinate << "." << std::endl;
+            return 1;
+        }
+        (kind == 'q' ? board.queens : board.blocked).push_back(cell);
+    }
+
+    constexpr size_t solutions_to_show = 10;
+    hi_res_timer timer;
+    const partial::completions found = has_avx2
+        ? qnssimd::solver<simd::avx2>::complete(board, solutions_to_show)
+        : qnssimd::solver<simd::sse2>::complete(board, solutions_to_show);
+    timer.Stop();
+    if (!found.valid)
+    {
+        std::cout << "Not a partial solution: a cell off the board, two queens attacking each other, or a queen on a blocked cell." << std::endl;
+        return 1;
+    }
+    for (const std::vector<int>& rows : found.solutions)
+    {
+        for (int row : rows)
+        {
+            std::cout << row << " ";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << found.count << " completions of " << board.queens.size() << " queens and " << board.blocked.size()
+        << " blocked cells, n = " << board_size << ", in " << timer.GetElapsedMicroseconds() / 1000.0 << " ms." << std::endl;
+    return 0;
+}
+
+// Queries per second, for batches of small completion problems.
+static int run_batch_study(size_t query_count, bool has_avx2)
+{
+    std::mt19937 generator(2024); // the same queries every time
+    std::vector<qnssimd::query> queries;
+    queries.reserve(query_count);
+    while (queries.size() < query_count)
+    {
+        partial::board board;
+        board.board_size = 10 + int(generator() % 7);
+        const int queens = 5 + int(generator() % 3);
+        for (int i = 0; i < queens; ++i)
+        {
+            board.queens.push_back({ int(generator() % board.board_size), int(generator() % board.board_size) });
+        }
+        qnssimd::query q;
+        if (qnssimd::make_query(board, q))
+        {
+            queries.push_back(q);
+        }
+    }
+    std::vector<qnsbatch::answer> answers(query_count);
+    qnsbatch::engine engine(has_avx2);
+    std::cout << query_count << " queries, " << engine.threads() << " threads, " << (has_avx2 ? "AVX2" : "SSE2") << std::endl;
+    for (qnsbatch::mode m : { qnsbatch::mode::count, qnsbatch::mode::first_solution })
+    {
+        hi_res_timer timer;
+        engine.run(queries.data(), queries.size(), answers.data(), m);
+        timer.Stop();
+        uint64_t total = 0;
+        for (const qnsbatch::answer& a : answers)
+        {
+            total += a.count;
+        }
+        std::cout << std::format("{:>16}: {:12.0f} queries/s, {} solutions", (m == qnsbatch::mode::count) ? "Count" : "First solution",
+            double(query_count) * 1e6 / timer.GetElapsedMicroseconds(), total) << std::endl;
+    }
+    return 0;
+}
+
+// Random access to the solutions, through an index saved next to the executable's working directory.
+static int run_unrank(int board_size, bool random_rank, uint64_t rank)
+{
+    const std::string path = "queens_index_" + std::to_string(board_size) + ".bin";
+    ranking::solution_index index;
+    hi_res_timer index_timer;
+    if (!index.load(path) || index.board_size() != board_size)
+    {
+        index = ranking::solution_index::build(board_size, ranking::solution_index::default_depth(board_size));
+        if (index.total() == 0)
+        {
+            std::cout << "Cannot index n = " << board_size << "." << std::endl;
+            return 1;
+        }
+        std::cout << (index.save(path) ? "Built and saved " : "Built (could not save) ") << path << ": ";
+    }
+    else
+    {
+        std::cout << "Loaded " << path << ": ";
+    }
+    std::cout << index.total() << " solutions, " << index.prefixes() << " prefixes of " << index.depth() << " columns, in "
+        << index_timer.GetElapsedMicroseconds() / 1000.0 << " ms." << std::endl;
+
+    if (random_rank)
+    {
+        std::mt19937_64 generator{ std::random_device()() };
+        rank = std::uniform_int_distribution<uint64_t>(0, index.total() - 1)(generator);
+    }
+    hi_res_timer timer;
+    const std::vector<int> rows = index.unrank(rank);
+    const double unrank_us = timer.GetElapsedMicroseconds();
+    if (rows.empty())
+    {
+        std::cout << "No solution #" << rank << ": there are " << index.total() << "." << std::endl;
+        return 1;
+    }
+    hi_res_timer rank_timer;
+    const uint64_t rank_back = index.rank(rows);
+    const double rank_us = rank_timer.GetElapsedMicroseconds();
+    std::cout << "Solution #" << rank << ":";
+    for (int row : rows)
+    {
+        std::cout << " " << row;
+    }
+    std::cout << " (unrank " << unrank_us << " us, rank " << rank_us << " us: #" << rank_back << ")" << std::endl;
+    return (rank_back == rank) ? 0 : 1;
+}
+
 int main(int argc, const char** argv)
 {
     bool verbose = false;
     bool test = false;
+    bool kernels = false;
+    bool golden_test = false;
+    bool fingerprints = false;
+    int golden_max_size = golden::last_known_size;
+    const char* csv_path = nullptr;
+    const char* json_path = nullptr;
+    const char* save_baseline_path = nullptr;
+    const char* compare_baseline_path = nullptr;
+    const char* output_path = nullptr;
+    const char* explicit_path = nullptr;
+    int completion_board_size = 0;
+    size_t batch_queries = 0;
+    bool daemon = false;
+    const char* socket_path = nullptr;
+    const char* completion_cells = nullptr;
+    int explicit_board_size = 0;
+    int output_board_size = 0;
+    packed::encoding output_coding = packed::encoding::plain;
+    int memo_study_max_size = 0;
+    int leaf_columns = 0;
+    int unrank_board_size = 0;
+    int first_board_size = 0;
+    int first_wanted = 1;
+    int local_search_board_size = 0;
+    bool random_seed = true;
+    uint64_t seed = 0;
+    bool random_rank = true;
+    uint64_t rank = 0;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -64,6 +467,127 @@ int main(int argc, const char** argv)
             case 't':
                 test = true;
                 break;
+            case 'm':
+                kernels = true;
+                break;
+            case 'f':
+                fingerprints = true;
+                break;
+            case 'g':
+                golden_test = true;
+                if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                {
+                    golden_max_size = atoi(argv[++i]);
+                }
+                break;
+            case 'c':
+                if (i + 1 < argc)
+                {
+                    csv_path = argv[++i];
+                }
+                break;
+            case 'j':
+                if (i + 1 < argc)
+                {
+                    json_path = argv[++i];
+                }
+                break;
+            case 'b':
+                if (i + 1 < argc)
+                {
+                    save_baseline_path = argv[++i];
+                }
+                break;
+            case 'r':
+                if (i + 1 < argc)
+                {
+                    compare_baseline_path = argv[++i];
+                }
+                break;
+            case 'u':
+                if (i + 1 < argc)
+                {
+                    unrank_board_size = atoi(argv[++i]);
+                    if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                    {
+                        rank = strtoull(argv[++i], nullptr, 10);
+                        random_rank = false;
+                    }
+                }
+                break;
+            case 'k':
+                if (i + 1 < argc)
+                {
+                    first_board_size = atoi(argv[++i]);
+                    if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                    {
+                        first_wanted = atoi(argv[++i]);
+                    }
+                }
+                break;
+            case 'n':
+                if (i + 1 < argc)
+                {
+                    local_search_board_size = atoi(argv[++i]);
+                    if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                    {
+                        seed = strtoull(argv[++i], nullptr, 10);
+                        random_seed = false;
+                    }
+                }
+                break;
+            case 'x':
+                memo_study_max_size = 15;
+                if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                {
+                    memo_study_max_size = atoi(argv[++i]);
+                }
+                break;
+            case 'l':
+                leaf_columns = 4;
+                if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                {
+                    leaf_columns = atoi(argv[++i]);
+                }
+                break;
+            case 'e':
+                if (i + 2 < argc)
+                {
+                    explicit_path = argv[++i];
+                    explicit_board_size = atoi(argv[++i]);
+                }
+                break;
+            case 'q':
+                if (i + 2 < argc)
+                {
+                    completion_board_size = atoi(argv[++i]);
+                    completion_cells = argv[++i];
+                }
+                break;
+            case 'y':
+                batch_queries = 100'000;
+                if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                {
+                    batch_queries = strtoull(argv[++i], nullptr, 10);
+                }
+                break;
+            case 'd':
+                daemon = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                {
+                    socket_path = argv[++i];
+                }
+                break;
+            case 'z':
+                output_coding = packed::encoding::shared_prefix;
+                break;
+            case 'o':
+                if (i + 2 < argc)
+                {
+                    output_path = argv[++i];
+                    output_board_size = atoi(argv[++i]);
+                }
+                break;
             case 's':
                 int short_trials = atoi(argv[++i]);
                 if (0 < short_trials)
@@ -83,31 +607,192 @@ int main(int argc, const char** argv)
         qns16cmn::test();
         qns16::solver::test();
         qns16avx2::solver::test();
+        return service::test() ? 1 : 0;
+    }
+
+    // Don't feel like adding a header just to declare four functions.
+    extern void print_out_instruction_sets();
+    extern bool avx2_supported();
+    extern bool bmi2_supported();
+    extern bool avx512_supported();
+    const bool has_avx2 = avx2_supported();
+    const bool has_bmi2 = bmi2_supported();
+    const bool has_avx512 = avx512_supported();
+    auto unsupported = [has_avx2, has_bmi2, has_avx512](const engine& eng) {
+        return (eng.requires_avx2 && !has_avx2) || (eng.requires_bmi2 && !has_bmi2) || (eng.requires_avx512 && !has_avx512);
+    };
+
+    for (const engine& eng : engines)
+    {
+        eng.set_fingerprint(fingerprints);
+    }
+
+    if (kernels)
+    {
+        qns::solver::bench_kernels();
+        qns16::solver::bench_kernels();
+        if (has_avx2)
+        {
+            qns16avx2::solver::bench_kernels();
+            qns16avx2mt::solver::bench_kernels();
+        }
         return 0;
     }
 
-    std::map< int, std::map<solution_type, microsecs_t> > durations;
+    if (daemon)
+    {
+        service::server server("queens_cache.txt", has_avx2);
+        return socket_path ? server.serve_socket(socket_path) : server.serve(std::cin, std::cout);
+    }
 
-    std::cout << "****************************** 64-bits, standard code ******************************" << std::endl;
-    run<qns::solver, decltype(durations)>(durations, 4, 9, solution_type::sixty_four_standard);
+    if (batch_queries)
+    {
+        return run_batch_study(batch_queries, has_avx2);
+    }
 
-    // Don't feel like adding a header just to declare two functions.
-    extern void print_out_instruction_sets();
-    print_out_instruction_sets();
+    if (completion_cells)
+    {
+        return run_completion(completion_board_size, completion_cells, has_avx2);
+    }
 
-    extern bool avx2_supported();
-    if (avx2_supported())
+    qnsbits::solver::set_leaf_table(leaf_columns);
+
+    if (memo_study_max_size)
     {
-        std::cout << "****************************** 256-bits, AVX2, multi threaded ******************************" << std::endl;
-        // I have four cores, no point trying under 8.
-        run<qns16avx2mt::solver, decltype(durations)>(durations, 8, 17, solution_type::avx2_multi_threaded);
+        return run_memo_study(memo_study_max_size);
+    }
 
-        std::cout << "****************************** 256-bits, AVX2, single threaded *****************************" << std::endl;
-        run<qns16avx2::solver, decltype(durations)>(durations, 4, 17, solution_type::avx2_single_threaded);
+    if (explicit_path)
+    {
+        return run_explicit(explicit_path, explicit_board_size);
     }
 
-    // Reference: support 16 by 16 without using AVX2.
-    run<qns16::solver, decltype(durations)>(durations, 4, 17, solution_type::two_fifty_six_standard);
+    if (local_search_board_size)
+    {
+        return run_local_search(local_search_board_size, random_seed, seed);
+    }
+
+    if (first_board_size)
+    {
+        return run_first(first_board_size, first_wanted);
+    }
+
+    if (unrank_board_size)
+    {
+        return run_unrank(unrank_board_size, random_rank, rank);
+    }
+
+    if (output_path)
+    {
+        // The first engine that supports the size: for 8 and up, the multithreaded one.
+        for (const engine& eng : engines)
+        {
+            if (unsupported(eng) || output_board_size < eng.first_size || output_board_size >= eng.end_size)
+            {
+                continue; // for
+            }
+            hi_res_timer timer;
+            try
+            {
+                packed::writer out(output_path, output_board_size, output_coding);
+                eng.set_board_size(output_board_size);
+                eng.set_output(&out);
+                golden::total(output_board_size, eng.count);
+                eng.set_output(nullptr);
+                out.close();
+            }
+            catch (const std::exception& e)
+            {
+                eng.set_output(nullptr);
+                std::cout << "Cannot write " << output_path << ": " << e.what() << std::endl;
+                return 1;
+            }
+            timer.Stop();
+            // Read it all back, decoding if need be.
+            const packed::mapped_solutions written(output_path);
+            uint64_t read_back = 0;
+            written.for_each([&read_back](uint64_t) { ++read_back; });
+            std::cout << eng.name << " wrote " << read_back << " solutions for n = " << written.board_size()
+                << " to " << output_path << " (" << written.payload_bytes() << " bytes) in "
+                << timer.GetElapsedMicroseconds() / 1000.0 << " ms." << std::endl;
+            return (read_back == golden::expected(output_board_size)) ? 0 : 1;
+        }
+        std::cout << "No engine supports n = " << output_board_size << "." << std::endl;
+        return 1;
+    }
+
+    if (golden_test)
+    {
+        int failures = 0;
+        int checks = 0;
+        std::map<int, std::map<solution_type, fp::fingerprint>> fingerprints_by_size;
+        for (const engine& eng : engines)
+        {
+            if (unsupported(eng))
+            {
+                continue; // for
+            }
+            for (int board_size = eng.first_size; board_size < eng.end_size && board_size <= golden_max_size; ++board_size)
+            {
+                eng.set_board_size(board_size);
+                fp::fingerprint& whole = fingerprints_by_size[board_size][eng.sol_type];
+                failures += golden::check(eng.name, board_size, eng.count, fingerprints ? eng.fingerprint : nullptr, &whole) ? 0 : 1;
+                ++checks;
+            }
+        }
+        // Same count is not the same solutions: every engine must agree with the reference, solution by solution.
+        for (auto& [board_size, by_engine] : fingerprints_by_size)
+        {
+            if (!fingerprints || !by_engine.contains(solution_type::two_fifty_six_standard))
+            {
+                continue; // for
+            }
+            const fp::fingerprint reference = by_engine[solution_type::two_fifty_six_standard];
+            for (const engine& eng : engines)
+            {
+                if (by_engine.contains(eng.sol_type) && !(by_engine[eng.sol_type] == reference))
+                {
+                    std::cout << "FAIL " << eng.name << " n = " << board_size << ": fingerprint " << by_engine[eng.sol_type].to_string()
+                        << ", reference " << reference.to_string() << std::endl;
+                    ++failures;
+                }
+            }
+        }
+        failures += check_instances(golden_max_size);
+        checks += std::max(0, std::min(golden_max_size, golden::last_known_size) - golden::first_known_size + 1);
+        std::cout << (failures ? "FAILED: " : "PASSED: ") << checks - failures << " of " << checks << " counts match." << std::endl;
+        return failures ? 1 : 0;
+    }
+
+    std::map< int, std::map<solution_type, microsecs_t> > durations;
+    std::vector<bench::statistics> all_stats;
+
+    print_out_instruction_sets();
+
+    for (const engine& eng : engines)
+    {
+        if (unsupported(eng))
+        {
+            continue; // for
+        }
+        std::cout << "****************************** " << eng.name << " ******************************" << std::endl;
+        run(durations, all_stats, eng, fingerprints);
+    }
+
+    if (csv_path)
+    {
+        std::ofstream csv(csv_path);
+        bench::write_csv(csv, all_stats);
+    }
+    if (json_path)
+    {
+        std::ofstream json(json_path);
+        bench::write_json(json, all_stats);
+    }
+    if (save_baseline_path)
+    {
+        baseline::save(save_baseline_path, all_stats);
+    }
 
     // Display data. C++ 20 brings some handy methods, very nice to have.  
     using std::cout;
@@ -117,11 +802,21 @@ int main(int argc, const char** argv)
     auto ts = [](double d) { 
         return std::format("{:.3Lf}", d); 
     };
-    cout 
-        << "***************** Median durations (microseconds) ****************" << endl 
-        << "Size,      64 bits,       256 bits,           AVX2, AVX2 Multithreaded" << endl
-        << "---    ------------ --------------- --------------- --------------" << endl
-        ;
+    // One column per engine, in the order they ran, wide enough for its name.
+    auto width = [](const engine& eng) {
+        return std::max(15, int(std::string(eng.name).size()) + 1);
+    };
+    cout << "***************** Median durations (microseconds) ****************" << endl << "Size";
+    for (const engine& eng : engines)
+    {
+        cout << "," << setw(width(eng)) << eng.name;
+    }
+    cout << endl << "---";
+    for (const engine& eng : engines)
+    {
+        cout << " " << std::string(size_t(width(eng)), '-');
+    }
+    cout << endl;
     const char* sep = ",";
     const char* na = "N/A";
     auto either_or_na = [&ts, &na](std::map<solution_type, microsecs_t>& d_curr, solution_type st) {
@@ -130,12 +825,50 @@ int main(int argc, const char** argv)
     for (int board_size = 4; board_size < 17; ++board_size)
     {
         std::map<solution_type, microsecs_t>& d_current = durations[board_size];
-        cout << setw(2) << board_size << sep
-            << setw(15) << either_or_na(d_current, solution_type::sixty_four_standard)  << sep
-            << setw(15) << either_or_na(d_current, solution_type::two_fifty_six_standard)  << sep
-            << setw(15) << either_or_na(d_current, solution_type::avx2_single_threaded) << sep
-            << setw(15) << either_or_na(d_current, solution_type::avx2_multi_threaded) << endl
-            ;
+        cout << setw(4) << board_size;
+        for (const engine& eng : engines)
+        {
+            cout << sep << setw(width(eng)) << either_or_na(d_current, eng.sol_type);
+        }
+        cout << endl;
+    }
+
+    // Hardware counters, next to the medians, where the kernel lets us have them.
+    bool any_counters = false;
+    for (const auto& stats : all_stats)
+    {
+        any_counters = any_counters || bench::has_counters(stats);
+    }
+    if (any_counters)
+    {
+        cout
+            << "***************** Hardware counters, per run ****************" << endl
+            << "Size, Engine,                 Median (us),         Cycles,   Instructions,  IPC,  Branch misses,    L1D misses,  Front end stalls" << endl;
+        auto counter_or_na = [&na](const bench::statistics& st, perf::counter c) {
+            return st.counters_valid[size_t(c)] ? std::format("{:.0f}", st.counters[size_t(c)]) : std::string(na);
+        };
+        for (const auto& st : all_stats)
+        {
+            const double cycles = st.counters[size_t(perf::counter::cycles)];
+            const double instructions = st.counters[size_t(perf::counter::instructions)];
+            const bool has_ipc = st.counters_valid[size_t(perf::counter::cycles)] && st.counters_valid[size_t(perf::counter::instructions)] && cycles > 0.0;
+            cout << setw(2) << st.board_size << sep << " "
+                << std::left << setw(20) << st.engine << std::right << sep
+                << setw(15) << ts(st.p50) << sep
+                << setw(15) << counter_or_na(st, perf::counter::cycles) << sep
+                << setw(15) << counter_or_na(st, perf::counter::instructions) << sep
+                << setw(5) << (has_ipc ? std::format("{:.2f}", instructions / cycles) : std::string(na)) << sep
+                << setw(15) << counter_or_na(st, perf::counter::branch_misses) << sep
+                << setw(14) << counter_or_na(st, perf::counter::l1d_misses) << sep
+                << setw(18) << counter_or_na(st, perf::counter::frontend_stalls) << endl
+                ;
+        }
+    }
+
+    if (compare_baseline_path)
+    {
+        const int regressions = baseline::compare(compare_baseline_path, all_stats);
+        return regressions ? 1 : 0;
     }
 
     return 0;
@@ -13,6 +13,8 @@
 #include <string>
 #include <intrin.h>
 
+#include "instruction_set.h"
+
 class InstructionSet
 {
     // forward declarations
@@ -65,6 +67,8 @@ public:
     static bool AVX512ER(void) { return CPU_Rep.f_7_EBX_[27]; }
     static bool AVX512CD(void) { return CPU_Rep.f_7_EBX_[28]; }
     static bool SHA(void) { return CPU_Rep.f_7_EBX_[29]; }
+    static bool AVX512BW(void) { return CPU_Rep.f_7_EBX_[30]; }
+    static bool AVX512VL(void) { return CPU_Rep.f_7_EBX_[31]; }
 
     static bool PREFETCHWT1(void) { return CPU_Rep.f_7_ECX_[0]; }
 
@@ -215,10 +219,12 @@ void print_out_instruction_sets()
     support_message("AES", InstructionSet::AES());
     support_message("AVX", InstructionSet::AVX());
     support_message("AVX2", InstructionSet::AVX2());
+    support_message("AVX512BW", InstructionSet::AVX512BW());
     support_message("AVX512CD", InstructionSet::AVX512CD());
     support_message("AVX512ER", InstructionSet::AVX512ER());
     support_message("AVX512F", InstructionSet::AVX512F());
     support_message("AVX512PF", InstructionSet::AVX512PF());
+    support_message("AVX512VL", InstructionSet::AVX512VL());
     support_message("BMI1", InstructionSet::BMI1());
     support_message("BMI2", InstructionSet::BMI2());
     support_message("CLFSH", InstructionSet::CLFSH());
@@ -264,4 +270,46 @@ void print_out_instruction_sets()
 bool avx2_supported()
 {
     return InstructionSet::AVX2();
-} 
\ No newline at end of file
+} 
+bool bmi2_supported()
+{
+    return InstructionSet::BMI1() && InstructionSet::BMI2();
+}
+// The 256 bit forms of the AVX-512 word instructions.
+bool avx512_supported()
+{
+    return InstructionSet::AVX512F() && InstructionSet::AVX512BW() && InstructionSet::AVX512VL();
+}
+std::string cpu_brand()
+{
+    return InstructionSet::Brand();
+}
+
+// The extensions the engines care about, space separated. Part of the machine fingerprint of a benchmark baseline.
+std::string isa_flags()
+{
+    std::string flags;
+    auto add = [&flags](const char* isa_feature, bool is_supported) {
+        if (is_supported)
+        {
+            if (!flags.empty())
+            {
+                flags += ' ';
+            }
+            flags += isa_feature;
+        }
+    };
+    add("SSE2", InstructionSet::SSE2());
+    add("SSE4.2", InstructionSet::SSE42());
+    add("POPCNT", InstructionSet::POPCNT());
+    add("AVX", InstructionSet::AVX());
+    add("AVX2", InstructionSet::AVX2());
+    add("BMI1", InstructionSet::BMI1());
+    add("BMI2", InstructionSet::BMI2());
+    add("LZCNT", InstructionSet::LZCNT());
+    add("AVX512F", InstructionSet::AVX512F());
+    add("AVX512BW", InstructionSet::AVX512BW());
+    add("AVX512VL", InstructionSet::AVX512VL());
+    add("RDTSCP", InstructionSet::RDTSCP());
+    return flags;
+}
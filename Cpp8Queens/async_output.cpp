@@ -0,0 +1,115 @@
+#include "async_output.h"
+
+namespace async_out
+{
+    namespace
+    {
+        size_t power_of_two_at_least(size_t n)
+        {
+            size_t result = 2;
+            while (result < n)
+            {
+                result *= 2;
+            }
+            return result;
+        }
+    } // anonymous namespace
+
+    void producer::hand_off()
+    {
+        while (!m_pipeline->m_full.try_push(m_current))
+        {
+            std::this_thread::yield(); // cannot happen: the queue holds every block
+        }
+        m_pipeline->m_signals.fetch_add(1, std::memory_order_release);
+        m_pipeline->m_signals.notify_one();
+        block* next = nullptr;
+        while (!m_pipeline->m_empty.try_pop(next))
+        {
+            std::this_thread::yield(); // the writer is behind by all our blocks: wait for it
+        }
+        next->size = 0;
+        m_current = next;
+    }
+
+    void producer::flush()
+    {
+        if (m_current && m_current->size)
+        {
+            hand_off();
+        }
+    }
+
+    pipeline::pipeline(consumer_fn consume, int producers, int blocks_per_producer) :
+        m_producers(size_t(producers)),
+        m_full(power_of_two_at_least(size_t(producers) * size_t(blocks_per_producer))),
+        m_empty(power_of_two_at_least(size_t(producers) * size_t(blocks_per_producer))),
+        m_consume(std::move(consume))
+    {
+        for (producer& p : m_producers)
+        {
+            p.m_pipeline = this;
+            for (int i = 0; i < blocks_per_producer; ++i)
+            {
+                m_blocks.push_back(std::make_unique<block>());
+                if (i == 0)
+                {
+                    p.m_current = m_blocks.back().get();
+                }
+                else
+                {
+                    m_empty.try_push(m_blocks.back().get());
+                }
+            }
+        }
+        m_writer = std::thread(&pipeline::write_loop, this);
+    }
+
+    pipeline::~pipeline()
+    {
+        finish();
+    }
+
+    void pipeline::write_loop()
+    {
+        for (;;)
+        {
+            // Read before draining: a block pushed after this changes it, and the wait below returns at once.
+            const uint32_t signals = m_signals.load(std::memory_order_acquire);
+            // Set only after every producer has flushed: read before draining, it means nothing more will come.
+            const bool finishing = m_finishing.load(std::memory_order_acquire);
+            bool idle = true;
+            block* full = nullptr;
+            while (m_full.try_pop(full))
+            {
+                m_consume(full->solutions, full->size);
+                m_empty.try_push(full);
+                idle = false;
+            }
+            if (finishing)
+            {
+                break; // for
+            }
+            if (idle)
+            {
+                m_signals.wait(signals, std::memory_order_acquire); // asleep, off the solver threads' cores
+            }
+        }
+    }
+
+    void pipeline::finish()
+    {
+        if (!m_writer.joinable())
+        {
+            return;
+        }
+        for (producer& p : m_producers)
+        {
+            p.flush();
+        }
+        m_finishing.store(true, std::memory_order_release);
+        m_signals.fetch_add(1, std::memory_order_release);
+        m_signals.notify_one();
+        m_writer.join();
+    }
+} // namespace async_out
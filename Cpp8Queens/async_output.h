@@ -0,0 +1,158 @@
+#pragma once
+
+// async_output.h
+// Solution output off the search threads. Each solver thread fills fixed size blocks of packed solutions;
+// full blocks go through a lock free queue to one writer thread, and come back empty through another.
+// The solver threads only block when the writer falls behind by every block they own; the writer sleeps when there is
+// nothing to write.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace async_out
+{
+    /// <summary>
+    /// Bounded multi producer, multi consumer queue (Dmitry Vyukov's). Capacity is a power of two.
+    /// One atomic increment per push or pop, no locks, no allocation after construction.
+    /// </summary>
+    template <typename T>
+    class bounded_queue
+    {
+        struct cell
+        {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+        std::unique_ptr<cell[]> m_cells;
+        const size_t m_mask;
+        alignas(64) std::atomic<size_t> m_enqueue_position{ 0 };
+        alignas(64) std::atomic<size_t> m_dequeue_position{ 0 };
+    public:
+        explicit bounded_queue(size_t capacity) : m_cells(new cell[capacity]), m_mask(capacity - 1)
+        {
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+        bounded_queue(const bounded_queue&) = delete;
+        bounded_queue& operator = (const bounded_queue&) = delete;
+
+        bool try_push(T data)
+        {
+            size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell& c = m_cells[position & m_mask];
+                const size_t sequence = c.sequence.load(std::memory_order_acquire);
+                const intptr_t difference = intptr_t(sequence) - intptr_t(position);
+                if (difference == 0)
+                {
+                    if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        c.data = data;
+                        c.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false; // full
+                }
+                else
+                {
+                    position = m_enqueue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(T& data)
+        {
+            size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell& c = m_cells[position & m_mask];
+                const size_t sequence = c.sequence.load(std::memory_order_acquire);
+                const intptr_t difference = intptr_t(sequence) - intptr_t(position + 1);
+                if (difference == 0)
+                {
+                    if (m_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        data = c.data;
+                        c.sequence.store(position + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false; // empty
+                }
+                else
+                {
+                    position = m_dequeue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    constexpr size_t block_capacity = 8 * 1024; // 64 KB of packed solutions
+
+    struct block
+    {
+        size_t size = 0;
+        uint64_t solutions[block_capacity];
+    };
+
+    // Runs on the writer thread, one full block at a time, in the order the blocks arrive.
+    using consumer_fn = std::function<void(const uint64_t* solutions, size_t count)>;
+
+    class pipeline;
+
+    /// <summary>
+    /// One per solver thread, never shared. add() is a store and an increment, except once per block.
+    /// </summary>
+    class producer
+    {
+        pipeline* m_pipeline = nullptr;
+        block* m_current = nullptr;
+        void hand_off(); // full block out, empty block in
+        friend class pipeline;
+    public:
+        void add(uint64_t solution)
+        {
+            m_current->solutions[m_current->size++] = solution;
+            if (m_current->size == block_capacity)
+            {
+                hand_off();
+            }
+        }
+        void flush(); // whatever is in the current block; call when the thread is done
+    };
+
+    class pipeline
+    {
+        std::vector<std::unique_ptr<block>> m_blocks;
+        std::vector<producer> m_producers;
+        bounded_queue<block*> m_full;
+        bounded_queue<block*> m_empty;
+        consumer_fn m_consume;
+        std::atomic<bool> m_finishing{ false };
+        std::atomic<uint32_t> m_signals{ 0 }; // bumped for every full block and by finish(): the idle writer waits on it
+        std::thread m_writer;
+        void write_loop();
+        friend class producer;
+    public:
+        // Two blocks per producer: double buffering. Starts the writer thread.
+        pipeline(consumer_fn consume, int producers, int blocks_per_producer = 2);
+        ~pipeline(); // finish()
+        pipeline(const pipeline&) = delete;
+        pipeline& operator = (const pipeline&) = delete;
+
+        producer& get_producer(int index) { return m_producers[index]; }
+        void finish(); // flushes every producer, drains the queue and joins the writer thread
+    };
+} // namespace async_out
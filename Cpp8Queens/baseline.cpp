@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include "baseline.h"
+#include "instruction_set.h"
+
+namespace baseline
+{
+    namespace
+    {
+        const char* const brand_tag = "# machine: ";
+        const char* const isa_tag = "# isa: ";
+        const char* const threads_tag = "# threads: ";
+
+        bool starts_with(const std::string& line, const char* prefix, std::string& rest)
+        {
+            const std::string p(prefix);
+            if (line.compare(0, p.size(), p) != 0)
+            {
+                return false;
+            }
+            rest = line.substr(p.size());
+            return true;
+        }
+
+        // Good enough for what bench::write_csv produces: quoted names without embedded quotes.
+        std::vector<std::string> split_csv(const std::string& line)
+        {
+            std::vector<std::string> fields;
+            std::string field;
+            bool quoted = false;
+            for (char c : line)
+            {
+                if (c == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (c == ',' && !quoted)
+                {
+                    fields.push_back(field);
+                    field.clear();
+                }
+                else
+                {
+                    field += c;
+                }
+            }
+            fields.push_back(field);
+            return fields;
+        }
+
+        // Welch's t statistic for "current is slower than recorded". Positive means slower.
+        double welch_t(const bench::statistics& recorded, const bench::statistics& current)
+        {
+            const double var_r = recorded.stddev * recorded.stddev / double(std::max<size_t>(recorded.runs, 1));
+            const double var_c = current.stddev * current.stddev / double(std::max<size_t>(current.runs, 1));
+            const double denominator = std::sqrt(var_r + var_c);
+            if (denominator == 0.0)
+            {
+                // Single runs (e.g. 16x16): no variance to speak of, let the relative threshold decide.
+                return current.mean > recorded.mean ? INFINITY : -INFINITY;
+            }
+            return (current.mean - recorded.mean) / denominator;
+        }
+    } // anonymous namespace
+
+    machine this_machine()
+    {
+        return machine{ cpu_brand(), isa_flags(), std::thread::hardware_concurrency() };
+    }
+
+    void save(const std::string& path, const std::vector<bench::statistics>& all_stats)
+    {
+        const machine m = this_machine();
+        std::ofstream out(path);
+        out << brand_tag << m.brand << std::endl
+            << isa_tag << m.isa_flags << std::endl
+            << threads_tag << m.threads << std::endl;
+        bench::write_csv(out, all_stats);
+        std::cout << "Saved " << all_stats.size() << " results as baseline to " << path << "." << std::endl;
+    }
+
+    bool load(const std::string& path, machine& recorded_on, std::vector<bench::statistics>& all_stats)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cout << "Cannot open baseline " << path << std::endl;
+            return false;
+        }
+
+        std::map<std::string, size_t> columns;
+        std::string line;
+        std::string rest;
+        while (std::getline(in, line))
+        {
+            if (line.empty())
+            {
+                continue; // while
+            }
+            if (starts_with(line, brand_tag, rest))
+            {
+                recorded_on.brand = rest;
+                continue; // while
+            }
+            if (starts_with(line, isa_tag, rest))
+            {
+                recorded_on.isa_flags = rest;
+                continue; // while
+            }
+            if (starts_with(line, threads_tag, rest))
+            {
+                recorded_on.threads = unsigned(strtoul(rest.c_str(), nullptr, 10));
+                continue; // while
+            }
+
+            const std::vector<std::string> fields = split_csv(line);
+            if (columns.empty())
+            {
+                // Header. Look columns up by name, so that baselines survive new columns.
+                for (size_t i = 0; i < fields.size(); ++i)
+                {
+                    columns[fields[i]] = i;
+                }
+                for (const char* needed : { "engine", "board_size", "runs", "mean_us", "stddev_us" })
+                {
+                    if (!columns.contains(needed))
+                    {
+                        std::cout << "Not a baseline: " << path << " has no " << needed << " column" << std::endl;
+                        return false;
+                    }
+                }
+                continue; // while
+            }
+            auto field = [&fields, &columns](const char* name) -> std::string {
+                auto it = columns.find(name);
+                return (it != columns.end() && it->second < fields.size()) ? fields[it->second] : std::string("0");
+            };
+            bench::statistics s;
+            try
+            {
+                s.engine = field("engine");
+                s.board_size = std::stoi(field("board_size"));
+                s.runs = size_t(std::stoull(field("runs")));
+                s.mean = std::stod(field("mean_us"));
+                s.stddev = std::stod(field("stddev_us"));
+                s.p50 = std::stod(field("p50_us"));
+                s.success_count = std::stoull(field("success_count"));
+            }
+            catch (const std::exception&) // std::invalid_argument or std::out_of_range, from a damaged file
+            {
+                std::cout << "Cannot read baseline " << path << ", line: " << line << std::endl;
+                return false;
+            }
+            all_stats.push_back(s);
+        }
+        if (all_stats.empty())
+        {
+            std::cout << "No results in baseline " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    int compare(const std::string& path, const std::vector<bench::statistics>& current, const criteria& crit)
+    {
+        machine recorded_on;
+        std::vector<bench::statistics> recorded;
+        if (!load(path, recorded_on, recorded))
+        {
+            std::cout << "No comparison: baseline " << path << " could not be loaded." << std::endl;
+            return -1;
+        }
+
+        const machine now = this_machine();
+        if (recorded_on.brand != now.brand || recorded_on.isa_flags != now.isa_flags || recorded_on.threads != now.threads)
+        {
+            std::cout << "WARNING: baseline recorded on a different machine:" << std::endl
+                << "    then: " << recorded_on.brand << ", " << recorded_on.threads << " threads, " << recorded_on.isa_flags << std::endl
+                << "    now:  " << now.brand << ", " << now.threads << " threads, " << now.isa_flags << std::endl;
+        }
+
+        std::map<std::pair<std::string, int>, const bench::statistics*> by_key;
+        for (const auto& s : recorded)
+        {
+            by_key[{ s.engine, s.board_size }] = &s;
+        }
+
+        int regressions = 0;
+        std::cout << "***************** Comparison against baseline " << path << " ****************" << std::endl;
+        for (const auto& s : current)
+        {
+            auto it = by_key.find({ s.engine, s.board_size });
+            if (it == by_key.end())
+            {
+                continue; // for
+            }
+            const bench::statistics& r = *it->second;
+            if (!(r.mean > 0.0))
+            {
+                std::cout << std::setw(20) << s.engine << ", " << std::setw(2) << s.board_size
+                    << ": no usable mean in the baseline (" << r.mean << "), not compared." << std::endl;
+                continue; // for
+            }
+            const double change = (s.mean - r.mean) / r.mean;
+            const double t = welch_t(r, s);
+            const bool slower = change > crit.min_slowdown && t > crit.critical_t;
+            if (slower)
+            {
+                ++regressions;
+            }
+            std::cout << std::setw(20) << s.engine << ", " << std::setw(2) << s.board_size
+                << ": mean " << r.mean << " -> " << s.mean << " microseconds ("
+                << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%" << std::noshowpos << std::defaultfloat << std::setprecision(6)
+                << ", t = " << t << ")"
+                << (slower ? "  <== REGRESSION" : "") << std::endl;
+            if (r.success_count != 0 && r.success_count != s.success_count)
+            {
+                std::cout << "    Solutions changed: " << r.success_count << " -> " << s.success_count << std::endl;
+            }
+        }
+        std::cout << regressions << " significant slowdown(s)." << std::endl;
+        return regressions;
+    }
+} // namespace baseline
@@ -0,0 +1,34 @@
+#pragma once
+
+// baseline.h
+// Save benchmark statistics with the machine they ran on, and compare later runs against them.
+
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace baseline
+{
+    struct machine
+    {
+        std::string brand;
+        std::string isa_flags;
+        unsigned threads = 0;
+    };
+
+    struct criteria
+    {
+        double min_slowdown = 0.03;    // Ignore anything under 3%, whatever the statistics say.
+        double critical_t = 3.0;       // Welch's t on the means, one-sided. Generous on purpose: noisy machines.
+    };
+
+    machine this_machine();
+
+    void save(const std::string& path, const std::vector<bench::statistics>& all_stats);
+    bool load(const std::string& path, machine& recorded_on, std::vector<bench::statistics>& all_stats);
+
+    // Prints one line per engine and board size found in both, returns how many got significantly slower.
+    // -1 if the baseline is missing or cannot be read: no comparison is not the same as no regression.
+    int compare(const std::string& path, const std::vector<bench::statistics>& current, const criteria& crit = criteria());
+} // namespace baseline
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch_queries.h"
+
+namespace qnsbatch
+{
+    namespace
+    {
+        // Queries per pick: enough to keep the shared counter out of the way, few enough to even out the ends.
+        constexpr size_t chunk_size = 64;
+
+        using kernel_fn = uint64_t (*)(const qnssimd::query&, bool, int8_t*);
+    }
+
+    class engine::impl
+    {
+        const kernel_fn m_kernel;
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake; // workers: a new batch, or time to go
+        std::condition_variable m_idle; // caller: every worker is done with the batch
+        uint64_t m_generation = 0; // batches so far
+        bool m_quit = false;
+        size_t m_working = 0; // workers not done with this batch yet
+
+        // This batch. Written by run() before waking the workers, under the mutex.
+        const qnssimd::query* m_queries = nullptr;
+        answer* m_answers = nullptr;
+        size_t m_count = 0;
+        bool m_first_only = false;
+        std::atomic<size_t> m_next = 0;
+
+        // Chunks, until there are none left. The search needs nothing beyond its stack and the answer's rows.
+        void work()
+        {
+            for (size_t first = m_next.fetch_add(chunk_size); first < m_count; first = m_next.fetch_add(chunk_size))
+            {
+                const size_t end = std::min(first + chunk_size, m_count);
+                for (size_t i = first; i < end; ++i)
+                {
+                    m_answers[i].count = m_kernel(m_queries[i], m_first_only, m_answers[i].rows);
+                }
+            }
+        }
+
+        void worker_loop()
+        {
+            uint64_t seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this, seen] { return m_quit || m_generation != seen; });
+                    if (m_quit)
+                    {
+                        return;
+                    }
+                    seen = m_generation;
+                }
+                work();
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_working == 0)
+                {
+                    m_idle.notify_one();
+                }
+            }
+        }
+
+    public:
+        impl(bool use_avx2, int threads) :
+            m_kernel(use_avx2 ? kernel_fn(&qnssimd::solver<simd::avx2>::complete) : kernel_fn(&qnssimd::solver<simd::sse2>::complete))
+        {
+            if (threads <= 0)
+            {
+                threads = std::max(1, (int)std::thread::hardware_concurrency());
+            }
+            for (int i = 1; i < threads; ++i) // the caller is the first
+            {
+                m_workers.emplace_back(&impl::worker_loop, this);
+            }
+        }
+
+        ~impl()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_quit = true;
+            }
+            m_wake.notify_all();
+            for (std::thread& t : m_workers)
+            {
+                t.join();
+            }
+        }
+
+        void run(const qnssimd::query* queries, size_t count, answer* answers, mode m)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queries = queries;
+                m_answers = answers;
+                m_count = count;
+                m_first_only = (m == mode::first_solution);
+                m_next = 0;
+                m_working = m_workers.size();
+                ++m_generation;
+            }
+            m_wake.notify_all();
+            work();
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_idle.wait(lock, [this] { return m_working == 0; });
+        }
+
+        int threads() const
+        {
+            return int(m_workers.size()) + 1;
+        }
+    };
+
+    engine::engine(bool use_avx2, int threads) :
+        m_pImpl(new impl(use_avx2, threads))
+    {
+    }
+
+    engine::~engine() = default;
+
+    void engine::run(const qnssimd::query* queries, size_t count, answer* answers, mode m)
+    {
+        m_pImpl->run(queries, count, answers, m);
+    }
+
+    int engine::threads() const
+    {
+        return m_pImpl->threads();
+    }
+} // namespace qnsbatch
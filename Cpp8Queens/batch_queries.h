@@ -0,0 +1,47 @@
+#pragma once
+
+// batch_queries.h
+// Many small completion queries at once, for throughput. The threads are started once, with the engine, and wait
+// between batches; each batch is cut into chunks that idle threads pick up, the caller's thread included. Queries are
+// prepared beforehand (qnssimd::make_query), answers go into an array the caller owns: no allocation, no printing,
+// no globals, per query.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "simd_queens.h"
+
+namespace qnsbatch
+{
+    enum class mode
+    {
+        count,          // every completion
+        first_solution  // stop at the first one
+    };
+
+    struct answer
+    {
+        uint64_t count = 0; // 0 or 1 in first_solution mode
+        int8_t rows[simd::map_rows]; // first_solution mode, if count is 1: the rows by column
+    };
+
+    /// <summary>
+    /// Persistent pool for batches of queries, on the AVX2 backend or the SSE2 one.
+    /// One batch at a time: run() returns when every answer is in.
+    /// </summary>
+    class engine
+    {
+        class impl;
+        std::unique_ptr<impl> m_pImpl;
+    public:
+        // threads: 0 for one per hardware thread, the caller's among them.
+        engine(bool use_avx2, int threads = 0);
+        ~engine();
+        engine(const engine&) = delete;
+        engine& operator = (const engine&) = delete;
+
+        void run(const qnssimd::query* queries, size_t count, answer* answers, mode m);
+        int threads() const; // the caller's included
+    };
+}
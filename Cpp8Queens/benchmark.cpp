@@ -0,0 +1,309 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+
+#include "benchmark.h"
+
+namespace bench
+{
+    namespace
+    {
+        // Linear interpolation between closest ranks. PRECONDITION: sorted, not empty.
+        double percentile(const std::vector<double>& sorted, double p)
+        {
+            const double rank = p * double(sorted.size() - 1);
+            const size_t below = size_t(rank);
+            const size_t above = std::min(below + 1, sorted.size() - 1);
+            const double fraction = rank - double(below);
+            return sorted[below] + (sorted[above] - sorted[below]) * fraction;
+        }
+
+        double mean_of(const std::vector<double>& samples)
+        {
+            return std::accumulate(samples.cbegin(), samples.cend(), 0.0) / double(samples.size());
+        }
+
+        // Sample standard deviation (n - 1).
+        double stddev_of(const std::vector<double>& samples, double mean)
+        {
+            if (samples.size() < 2)
+            {
+                return 0.0;
+            }
+            double sum_of_squares = 0.0;
+            for (double sample : samples)
+            {
+                sum_of_squares += (sample - mean) * (sample - mean);
+            }
+            return std::sqrt(sum_of_squares / double(samples.size() - 1));
+        }
+
+        // Pick a unit so that the numbers stay readable, from 4x4 (about a microsecond) to 16x16 (seconds).
+        void scale(double microseconds, double& divisor, const char*& unit)
+        {
+            if (microseconds < 1'000)
+            {
+                divisor = 1.0;
+                unit = "microseconds";
+            }
+            else if (microseconds < 1'000'000)
+            {
+                divisor = 1e3;
+                unit = "milliseconds";
+            }
+            else
+            {
+                divisor = 1e6;
+                unit = "seconds";
+            }
+        }
+    } // anonymous namespace
+
+    statistics measure(const std::string& engine, int board_size, trial_fn run_trial, const options& opts)
+    {
+        std::vector<double> samples;
+        samples.reserve(std::min(opts.max_runs, 1'024));
+        trial last{};
+
+        perf::counters hardware;
+        const bool counting = opts.hardware_counters && hardware.available();
+        std::array<double, perf::counter_count> counter_sums{};
+        std::array<size_t, perf::counter_count> counter_runs{};
+        auto counted_trial = [&]() {
+            if (!counting)
+            {
+                return run_trial();
+            }
+            hardware.start();
+            const trial t = run_trial();
+            const perf::readings r = hardware.stop();
+            for (size_t i = 0; i < perf::counter_count; ++i)
+            {
+                if (r.valid[i])
+                {
+                    counter_sums[i] += double(r.values[i]);
+                    ++counter_runs[i];
+                }
+            }
+            return t;
+        };
+        if (opts.hardware_counters && !hardware.available())
+        {
+            static bool warned = false;
+            if (!warned)
+            {
+                warned = true;
+                std::cout << "Hardware counters unavailable (not Linux, or restricted by perf_event_paranoid); timing only." << std::endl;
+            }
+        }
+
+        // Warm-up: caches, branch predictors, turbo. Whole solves of 16x16 take seconds, there the warm-up is the sample.
+        for (int i = 0; i < opts.warmup_runs; ++i)
+        {
+            last = counted_trial();
+            if (double(last.microseconds) > opts.long_trial_seconds * 1e6)
+            {
+                samples.push_back(double(last.microseconds));
+                break; // for
+            }
+        }
+        if (samples.empty())
+        {
+            counter_sums.fill(0.0);
+            counter_runs.fill(0);
+        }
+
+        statistics stats;
+        stats.engine = engine;
+        stats.board_size = board_size;
+
+        // The budget counts measured time only, so a kept warm-up sample counts too.
+        auto seconds_spent = [&samples]() {
+            return std::accumulate(samples.cbegin(), samples.cend(), 0.0) / 1e6;
+        };
+
+        while (int(samples.size()) < opts.max_runs)
+        {
+            if (int(samples.size()) >= opts.min_runs)
+            {
+                const double mean = mean_of(samples);
+                const double half_width = opts.confidence_z * stddev_of(samples, mean) / std::sqrt(double(samples.size()));
+                if (half_width <= opts.relative_precision * mean)
+                {
+                    stats.converged = true;
+                    break; // while
+                }
+            }
+            if (!samples.empty() && seconds_spent() > opts.max_seconds)
+            {
+                break; // while
+            }
+            last = counted_trial();
+            samples.push_back(double(last.microseconds));
+        }
+
+        for (size_t i = 0; i < perf::counter_count; ++i)
+        {
+            stats.counters_valid[i] = counter_runs[i] > 0;
+            stats.counters[i] = counter_runs[i] ? counter_sums[i] / double(counter_runs[i]) : 0.0;
+        }
+
+        stats.runs = samples.size();
+        stats.mean = mean_of(samples);
+        stats.stddev = stddev_of(samples, stats.mean);
+        stats.ci_half_width = opts.confidence_z * stats.stddev / std::sqrt(double(samples.size()));
+
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.p50 = percentile(samples, 0.50);
+        stats.p90 = percentile(samples, 0.90);
+        stats.p99 = percentile(samples, 0.99);
+        stats.max = samples.back();
+
+        stats.success_count = last.success_count;
+        stats.failures_count = last.failures_count;
+        if (stats.p50 > 0.0)
+        {
+            stats.nodes_per_second = double(last.success_count + last.failures_count) / (stats.p50 / 1e6);
+        }
+        return stats;
+    }
+
+    void print(const statistics& stats)
+    {
+        std::time_t now = time(nullptr);
+        double divisor = 1.0;
+        const char* unit = nullptr;
+        scale(stats.p50, divisor, unit);
+
+        std::cout
+            << std::asctime(std::localtime(&now))
+            << " " << stats.engine << ", " << stats.board_size << "x" << stats.board_size << ": "
+            << stats.runs << " runs" << (stats.converged ? "" : " (confidence interval not reached)")
+            << ", in " << unit << ": min " << stats.min / divisor
+            << ", p50 " << stats.p50 / divisor
+            << ", p90 " << stats.p90 / divisor
+            << ", p99 " << stats.p99 / divisor
+            << ", max " << stats.max / divisor
+            << ", mean " << stats.mean / divisor << " +/- " << stats.ci_half_width / divisor
+            << ", stddev " << stats.stddev / divisor
+            << "; " << std::fixed << std::setprecision(0) << stats.nodes_per_second << std::defaultfloat << std::setprecision(6)
+            << " nodes per second." << std::endl;
+
+        if (has_counters(stats))
+        {
+            std::cout << " Per run:";
+            for (size_t i = 0; i < perf::counter_count; ++i)
+            {
+                if (stats.counters_valid[i])
+                {
+                    std::cout << " " << perf::name(perf::counter(i)) << " " << std::fixed << std::setprecision(0) << stats.counters[i];
+                }
+            }
+            const size_t cycles = size_t(perf::counter::cycles);
+            const size_t instructions = size_t(perf::counter::instructions);
+            if (stats.counters_valid[cycles] && stats.counters_valid[instructions] && stats.counters[cycles] > 0.0)
+            {
+                std::cout << ", IPC " << std::setprecision(2) << stats.counters[instructions] / stats.counters[cycles];
+            }
+            std::cout << std::defaultfloat << std::setprecision(6) << "." << std::endl;
+        }
+    }
+
+    bool has_counters(const statistics& stats)
+    {
+        for (bool valid : stats.counters_valid)
+        {
+            if (valid)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void write_csv(std::ostream& out, const std::vector<statistics>& all_stats)
+    {
+        out << "engine,board_size,runs,converged,mean_us,stddev_us,ci_half_width_us,min_us,p50_us,p90_us,p99_us,max_us,"
+            << "success_count,failures_count,nodes_per_second";
+        for (size_t i = 0; i < perf::counter_count; ++i)
+        {
+            out << ',' << perf::name(perf::counter(i));
+        }
+        out << std::endl;
+        out << std::setprecision(12);
+        for (const auto& s : all_stats)
+        {
+            out << '"' << s.engine << '"' << ','
+                << s.board_size << ','
+                << s.runs << ','
+                << (s.converged ? 1 : 0) << ','
+                << s.mean << ','
+                << s.stddev << ','
+                << s.ci_half_width << ','
+                << s.min << ','
+                << s.p50 << ','
+                << s.p90 << ','
+                << s.p99 << ','
+                << s.max << ','
+                << s.success_count << ','
+                << s.failures_count << ','
+                << s.nodes_per_second;
+            for (size_t i = 0; i < perf::counter_count; ++i)
+            {
+                out << ',';
+                if (s.counters_valid[i])
+                {
+                    out << s.counters[i]; // Empty when unavailable.
+                }
+            }
+            out << std::endl;
+        }
+    }
+
+    void write_json(std::ostream& out, const std::vector<statistics>& all_stats)
+    {
+        // Engine names are ours, no need to escape them.
+        out << std::setprecision(12) << "[" << std::endl;
+        const char* separator = "";
+        for (const auto& s : all_stats)
+        {
+            out << separator
+                << "  { \"engine\": \"" << s.engine << "\""
+                << ", \"board_size\": " << s.board_size
+                << ", \"runs\": " << s.runs
+                << ", \"converged\": " << (s.converged ? "true" : "false")
+                << ", \"mean_us\": " << s.mean
+                << ", \"stddev_us\": " << s.stddev
+                << ", \"ci_half_width_us\": " << s.ci_half_width
+                << ", \"min_us\": " << s.min
+                << ", \"p50_us\": " << s.p50
+                << ", \"p90_us\": " << s.p90
+                << ", \"p99_us\": " << s.p99
+                << ", \"max_us\": " << s.max
+                << ", \"success_count\": " << s.success_count
+                << ", \"failures_count\": " << s.failures_count
+                << ", \"nodes_per_second\": " << s.nodes_per_second;
+            for (size_t i = 0; i < perf::counter_count; ++i)
+            {
+                out << ", \"" << perf::name(perf::counter(i)) << "\": ";
+                if (s.counters_valid[i])
+                {
+                    out << s.counters[i];
+                }
+                else
+                {
+                    out << "null";
+                }
+            }
+            out << " }";
+            separator = ",\n";
+        }
+        out << std::endl << "]" << std::endl;
+    }
+} // namespace bench
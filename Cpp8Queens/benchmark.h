@@ -0,0 +1,74 @@
+#pragma once
+
+// benchmark.h
+// Benchmark harness shared by all engines: warm-up, adaptive number of runs, percentiles, hardware counters,
+// CSV and JSON export.
+
+#include <array>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "high_res_clock.h"
+#include "perf_counters.h"
+
+namespace bench
+{
+    // One timed solve. Engines time the search only; setup and output stay outside the measured region.
+    struct trial
+    {
+        hi_res_timer::microsecs_t microseconds = 0;
+        unsigned long long success_count = 0;
+        unsigned long long failures_count = 0;
+    };
+
+    using trial_fn = trial(*)();
+
+    struct options
+    {
+#ifdef _DEBUG
+        int warmup_runs = 0;
+        int min_runs = 1;
+        int max_runs = 1;
+#else
+        int warmup_runs = 3;
+        int min_runs = 5;
+        int max_runs = 10'000;
+#endif // _DEBUG
+        double max_seconds = 10.0;          // Time budget for the measured runs of one engine and board size.
+        double long_trial_seconds = 1.0;    // A warm-up run longer than this is kept as a sample, and warm-up ends.
+        double relative_precision = 0.01;   // Stop when the confidence interval of the mean is within 1% of it.
+        double confidence_z = 1.96;         // 95%, normal approximation.
+        bool hardware_counters = true;      // perf_event_open, where available.
+    };
+
+    struct statistics
+    {
+        std::string engine;
+        int board_size = 0;
+        size_t runs = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double ci_half_width = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        unsigned long long success_count = 0;
+        unsigned long long failures_count = 0;
+        // Leaves are the nodes where the search stops: solutions plus dead ends.
+        double nodes_per_second = 0.0;
+        bool converged = false;
+        // Hardware counters, average per measured run. Around the whole trial, so setup is included.
+        std::array<double, perf::counter_count> counters{};
+        std::array<bool, perf::counter_count> counters_valid{};
+    };
+
+    statistics measure(const std::string& engine, int board_size, trial_fn run_trial, const options& opts = options());
+
+    void print(const statistics& stats);
+    bool has_counters(const statistics& stats);
+    void write_csv(std::ostream& out, const std::vector<statistics>& all_stats);
+    void write_json(std::ostream& out, const std::vector<statistics>& all_stats);
+} // namespace bench
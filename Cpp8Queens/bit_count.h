@@ -0,0 +1,65 @@
+#pragma once
+
+// bit_count.h
+// Counting completions of a partial board, one bit per row. What a column sees of the queens already placed
+// is three masks over its rows: rows taken, and rows attacked along each diagonal. Moving to the next column
+// shifts the diagonals by one. No maps, no threats tables: the cheapest way to count what is below a node.
+
+#include <bit>
+#include <cstdint>
+
+namespace bits
+{
+    struct state
+    {
+        uint32_t rows = 0;      // rows taken
+        uint32_t down = 0;      // attacked along the main diagonals, in this column
+        uint32_t up = 0;        // attacked along the second diagonals, in this column
+    };
+
+    inline uint32_t all_rows(int board_size)
+    {
+        return (1u << board_size) - 1;
+    }
+
+    inline uint32_t free_rows(const state& s, uint32_t all)
+    {
+        return all & ~(s.rows | s.down | s.up);
+    }
+
+    // Queen in the row of row_bit, in this column: what the next column sees.
+    inline state place(const state& s, uint32_t row_bit)
+    {
+        return state{ s.rows | row_bit, (s.down | row_bit) << 1, (s.up | row_bit) >> 1 };
+    }
+
+    // The state after placing rows[0 .. columns - 1]; false if two of them attack each other.
+    inline bool place_all(const int* rows, int columns, state& s)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            const uint32_t row_bit = 1u << rows[column];
+            if (!(free_rows(s, ~0u) & row_bit))
+            {
+                return false;
+            }
+            s = place(s, row_bit);
+        }
+        return true;
+    }
+
+    // Completions from here on: every column until all rows are taken.
+    inline uint64_t count(const state& s, uint32_t all)
+    {
+        if (s.rows == all)
+        {
+            return 1;
+        }
+        uint64_t result = 0;
+        for (uint32_t candidates = free_rows(s, all); candidates; candidates &= candidates - 1)
+        {
+            result += count(place(s, candidates & (0u - candidates)), all);
+        }
+        return result;
+    }
+} // namespace bits
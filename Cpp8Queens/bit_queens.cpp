@@ -0,0 +1,242 @@
+#define _CRT_SECURE_NO_WARNINGS  // We do NOT support Microsoft's War on Standards.
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "bit_queens.h"
+#include "bit_count.h"
+#include "high_res_clock.h"
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "leaf_table.h"
+#include "solution_stream.h"
+
+namespace qnsbits
+{
+    static constexpr int maximum_allowed_board_size = 20; // The memo key has 21 bits per mask.
+
+    static uint64_t failures_count = 0;
+    static uint64_t success_count = 0;
+    static uint64_t nodes_count = 0;
+    static bool verbose = false;
+    static int board_size = 16; // Supported sizes: 4 - 20
+    static uint32_t all = bits::all_rows(16);
+    static int rows[maximum_allowed_board_size]; // the current partial solution
+    static bool fingerprinting = false;
+    static fp::fingerprint solutions_fingerprint;
+    static packed::writer* output = nullptr;
+    static int memo_columns = 0;
+    static std::unique_ptr<memo::table> cache;
+    static memo::table* active_cache = nullptr; // cache, when this search may use it
+    static int leaf_columns = 0;
+    static leaves::table leaf_table; // built for board_size and leaf_columns, when needed
+    static const leaves::table* active_leaves = nullptr; // leaf_table, when this search may use it
+
+    // Only what the columns left can see. A main diagonal bit on row r reaches rows r to r + columns_left - 1,
+    // a second diagonal bit rows r - columns_left + 1 to r: if none of them is free, the bit changes nothing.
+    // Dropping those bits makes many more states equal.
+    inline uint64_t memo_key(const bits::state& s, int columns_left)
+    {
+        const uint32_t free_rows = all & ~s.rows;
+        uint32_t down_reach = 0;
+        uint32_t up_reach = 0;
+        for (int j = 0; j < columns_left; ++j)
+        {
+            down_reach |= free_rows >> j;
+            up_reach |= free_rows << j;
+        }
+        return uint64_t(s.rows) | (uint64_t(s.down & down_reach & all) << 21) | (uint64_t(s.up & up_reach & all) << 42);
+    }
+
+    uint64_t do_count(const bits::state& s, int column)
+    {
+        ++nodes_count;
+        if (s.rows == all)
+        {
+            // Success!
+            if (fingerprinting)
+            {
+                fp::fold(solutions_fingerprint, rows, board_size);
+            }
+            if (output)
+            {
+                output->add_with_mirror(rows);
+            }
+            return 1;
+        }
+        const uint32_t candidates = bits::free_rows(s, all);
+        if (!candidates)
+        {
+            ++failures_count;
+            return 0;
+        }
+
+        const int columns_left = board_size - column;
+        if (active_leaves && columns_left == leaf_columns)
+        {
+            return active_leaves->count(s);
+        }
+        const bool memoised = active_cache && columns_left <= memo_columns && columns_left > 1;
+        uint64_t key = 0;
+        uint64_t result = 0;
+        if (memoised)
+        {
+            key = memo_key(s, columns_left);
+            if (active_cache->find(key, result))
+            {
+                return result;
+            }
+        }
+        for (uint32_t left = candidates; left; left &= left - 1)
+        {
+            const uint32_t row_bit = left & (0u - left);
+            rows[column] = std::countr_zero(row_bit);
+            result += do_count(bits::place(s, row_bit), column + 1);
+        }
+        if (memoised)
+        {
+            active_cache->store(key, result, columns_left);
+        }
+        return result;
+    } // uint64_t do_count(const bits::state& s, int column)
+
+    // Timed search with the first queen in rows [first_row, end_row).
+    bench::trial run_rows(int first_row, int end_row)
+    {
+        tsc::span setup_span(tsc::phase::setup);
+        failures_count = 0;
+        success_count = 0;
+        nodes_count = 0;
+        solutions_fingerprint = fp::fingerprint();
+        if ((fingerprinting || output) && board_size > fp::maximum_board_size)
+        {
+            throw std::invalid_argument("Fingerprints and solution files take boards up to 16x16, not " + std::to_string(board_size));
+        }
+        // Counts only: every solution has to be visited otherwise.
+        active_cache = (cache && !fingerprinting && !output) ? cache.get() : nullptr;
+        if (active_cache)
+        {
+            active_cache->clear(); // cold, like the other engines
+        }
+        active_leaves = nullptr;
+        if (leaf_columns && leaf_columns < board_size && !fingerprinting && !output)
+        {
+            if (leaf_table.board_size() != board_size || leaf_table.columns() != leaf_columns)
+            {
+                leaf_table = leaves::table(board_size, leaf_columns); // once per size, not per trial
+            }
+            active_leaves = &leaf_table;
+        }
+
+        tsc::span search_span(tsc::phase::search);
+        hi_res_timer timer;
+        for (int current_row = first_row; current_row < end_row; ++current_row)
+        {
+            rows[0] = current_row;
+            success_count += do_count(bits::place(bits::state(), 1u << current_row), 1);
+        }
+        timer.Stop();
+        return bench::trial{ timer.GetElapsedMicroseconds(), success_count, failures_count };
+    }
+
+    bench::trial solver::run_trial()
+    {
+        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+        return run_rows(0, starting_rows_to_test);
+    }
+
+    unsigned long long solver::count(int first_row, int end_row)
+    {
+        return run_rows(first_row, end_row).success_count;
+    }
+
+    double solver::solve()
+    {
+        tsc::reset_phases();
+        const bench::statistics stats = bench::measure("Bit masks", board_size, &run_trial);
+        bench::print(stats);
+        tsc::print_phases();
+        std::cout.flush();
+        return stats.p50;
+    }
+
+    void solver::set_fingerprint(bool on)
+    {
+        fingerprinting = on;
+    }
+
+    fp::fingerprint solver::fingerprint()
+    {
+        return solutions_fingerprint;
+    }
+
+    void solver::set_output(packed::writer* out)
+    {
+        output = out;
+    }
+
+    void solver::set_verbose(bool new_val)
+    {
+        std::cout << "Setting verbose to " << new_val << std::endl;
+        verbose = new_val;
+    }
+
+    void solver::set_board_size(int size)
+    {
+        if (size < 4)
+        {
+            std::cout << "Size must be at least 4, it is " << size << ". Doing nothing.";
+            return;
+        }
+        if (size > maximum_allowed_board_size)
+        {
+            std::cout << "Size must be at most " << maximum_allowed_board_size << ", it is " << size << ". Doing nothing.";
+            return;
+        }
+        board_size = size;
+        all = bits::all_rows(size);
+    }
+
+    void solver::set_memo(int columns, int log2_buckets)
+    {
+        memo_columns = columns;
+        active_cache = nullptr;
+        cache.reset();
+        if (columns > 1)
+        {
+            cache = std::make_unique<memo::table>(log2_buckets);
+        }
+    }
+
+    void solver::set_leaf_table(int columns)
+    {
+        leaf_columns = std::clamp(columns, 0, 5);
+        active_leaves = nullptr;
+        leaf_table = leaves::table();
+    }
+
+    size_t solver::leaf_table_bytes()
+    {
+        return leaf_table.bytes();
+    }
+
+    unsigned long long solver::nodes()
+    {
+        return nodes_count;
+    }
+
+    memo::table::statistics solver::memo_statistics()
+    {
+        return cache ? cache->stats() : memo::table::statistics();
+    }
+
+    size_t solver::memo_bytes()
+    {
+        return cache ? cache->bytes() : 0;
+    }
+} // namespace qnsbits
@@ -0,0 +1,51 @@
+#pragma once
+
+// bit_queens.h
+// Solution for up to 20x20, with three row masks per column instead of a threats map (see bit_count.h),
+// and optionally a transposition table for the subtrees of the last few columns, or a table of every way of filling them.
+
+#include <cstddef>
+
+#include "transposition_table.h"
+
+namespace bench
+{
+    struct trial; // forward declaration
+}
+
+namespace fp
+{
+    struct fingerprint; // forward declaration
+}
+
+namespace packed
+{
+    class writer; // forward declaration
+}
+
+namespace qnsbits
+{
+    // namespace cannot be a template argument
+    struct solver
+    {
+        static double solve(); // returns median microseconds
+        static bench::trial run_trial(); // one timed solve, no output
+        static unsigned long long count(int first_row, int end_row); // solutions with the first queen in rows [first_row, end_row)
+        static void set_fingerprint(bool on); // fold every solution found into fingerprint(); boards up to 16x16
+        static fp::fingerprint fingerprint(); // of the last search, when enabled
+        static void set_output(packed::writer* out); // every solution found goes there too, nullptr for none; up to 16x16
+        static void set_verbose(bool new_val);
+        static void set_board_size(int size);
+
+        // Cache subtree counts when this many columns, or fewer, are left (0: off), in 64 << log2_buckets bytes.
+        // Ignored while fingerprinting or writing solutions out: those need every solution, not counts.
+        static void set_memo(int columns, int log2_buckets = 16);
+        // Stop this many columns (3 to 5, 0: off) from the end, and count from a table of every way of filling them.
+        // Same restriction as the memo. The table is built by the first search of each board size.
+        static void set_leaf_table(int columns);
+        static size_t leaf_table_bytes(); // 0 before the first search
+        static unsigned long long nodes(); // visited by the last search
+        static memo::table::statistics memo_statistics(); // of the last search; all zeros without a table
+        static size_t memo_bytes(); // 0 without a table
+    };
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+// board_map.h
+// One board map, several instruction sets. The map is 16 rows of 16 bits, the layout every 16x16 engine uses:
+// row r is bits 16 r to 16 r + 15, column c is bit 15 - c of its row. A set bit is a threatened cell.
+// A backend says how to hold the map in registers, and does the two things a search needs: OR in a queen's
+// threats, and list the free rows of a column as a mask. A solver written against a backend's static members
+// is instantiated once per instruction set; a new instruction set is one more backend, not one more engine.
+
+#include <array>
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace simd
+{
+    struct alignas(32) board_map
+    {
+        uint64_t u64[4] = {};
+    };
+
+    constexpr int map_rows = 16;
+
+    constexpr void set_cell(board_map& map, int row, int column)
+    {
+        map.u64[row / 4] |= uint64_t(0x8000 >> column) << (16 * (row % 4));
+    }
+
+    constexpr bool is_set(const board_map& map, int row, int column)
+    {
+        return ((map.u64[row / 4] >> (16 * (row % 4))) & (0x8000 >> column)) != 0;
+    }
+
+    constexpr board_map row_mask(int row)
+    {
+        board_map result;
+        result.u64[row / 4] = 0xffffULL << (16 * (row % 4));
+        return result;
+    }
+
+    constexpr board_map column_mask(int column)
+    {
+        board_map result;
+        for (int row = 0; row < map_rows; ++row)
+        {
+            set_cell(result, row, column);
+        }
+        return result;
+    }
+
+    // What a queen on (row, column) threatens: her row and both diagonals. Her column does not matter, the search
+    // never comes back to it.
+    constexpr board_map threat(int row, int column)
+    {
+        board_map result = row_mask(row);
+        for (int r = 0; r < map_rows; ++r)
+        {
+            for (int c = 0; c < map_rows; ++c)
+            {
+                if (r - c == row - column || r + c == row + column)
+                {
+                    set_cell(result, r, c);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Index row * 16 + column.
+    constexpr std::array<board_map, map_rows * map_rows> threats = [] {
+        std::array<board_map, map_rows * map_rows> A = {};
+        for (int row = 0; row < map_rows; ++row)
+        {
+            for (int column = 0; column < map_rows; ++column)
+            {
+                A[size_t(row * map_rows + column)] = threat(row, column);
+            }
+        }
+        return A;
+    }();
+
+    constexpr std::array<board_map, map_rows> column_masks = [] {
+        std::array<board_map, map_rows> A = {};
+        for (int column = 0; column < map_rows; ++column)
+        {
+            A[size_t(column)] = column_mask(column);
+        }
+        return A;
+    }();
+
+    /// <summary>
+    /// Plain 64 bit integers, four to a map. Runs anywhere.
+    /// </summary>
+    struct scalar
+    {
+        static constexpr const char* name = "scalar";
+        using vector_t = board_map;
+
+        static __forceinline vector_t load(const board_map& map)
+        {
+            return map;
+        }
+
+        static __forceinline vector_t or_(const vector_t& a, const vector_t& b)
+        {
+            return vector_t{ a.u64[0] | b.u64[0], a.u64[1] | b.u64[1], a.u64[2] | b.u64[2], a.u64[3] | b.u64[3] };
+        }
+
+        // One bit per row, set where the map has no bit under the column mask. There is at most one such bit per row:
+        // fold it down to bit 0 of its 16, and a multiplication gathers four rows at a time.
+        static __forceinline uint32_t free_rows(const vector_t& map, const vector_t& column_mask)
+        {
+            uint32_t result = 0;
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                uint64_t free_bits = ~map.u64[lane] & column_mask.u64[lane];
+                free_bits |= free_bits >> 8;
+                free_bits |= free_bits >> 4;
+                free_bits |= free_bits >> 2;
+                free_bits |= free_bits >> 1;
+                free_bits &= 0x0001'0001'0001'0001ULL;
+                result |= uint32_t(((free_bits * 0x0001'0002'0004'0008ULL) >> 48) & 0xf) << (4 * lane);
+            }
+            return result;
+        }
+    };
+
+    /// <summary>
+    /// Two 128 bit halves, rows 0 to 7 and 8 to 15. Every x64 CPU has SSE2.
+    /// </summary>
+    struct sse2
+    {
+        static constexpr const char* name = "SSE2";
+        struct vector_t
+        {
+            __m128i low;
+            __m128i high;
+        };
+
+        static __forceinline vector_t load(const board_map& map)
+        {
+            return vector_t{ _mm_load_si128(reinterpret_cast<const __m128i*>(&map.u64[0])),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&map.u64[2])) };
+        }
+
+        static __forceinline vector_t or_(const vector_t& a, const vector_t& b)
+        {
+            return vector_t{ _mm_or_si128(a.low, b.low), _mm_or_si128(a.high, b.high) };
+        }
+
+        // Compare each row to zero, pack the sixteen results to bytes, in row order, and movemask them.
+        static __forceinline uint32_t free_rows(const vector_t& map, const vector_t& column_mask)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i low = _mm_cmpeq_epi16(_mm_and_si128(map.low, column_mask.low), zero);
+            const __m128i high = _mm_cmpeq_epi16(_mm_and_si128(map.high, column_mask.high), zero);
+            return uint32_t(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+        }
+    };
+
+    /// <summary>
+    /// One 256 bit register.
+    /// </summary>
+    struct avx2
+    {
+        static constexpr const char* name = "AVX2";
+        using vector_t = __m256i;
+
+        static __forceinline vector_t load(const board_map& map)
+        {
+            return _mm256_load_si256(reinterpret_cast<const __m256i*>(&map));
+        }
+
+        static __forceinline vector_t or_(const vector_t a, const vector_t b)
+        {
+            return _mm256_or_si256(a, b);
+        }
+
+        // packs works within each 128 bit lane: rows 0 to 7 land in bytes 0 to 7, rows 8 to 15 in bytes 16 to 23.
+        static __forceinline uint32_t free_rows(const vector_t map, const vector_t column_mask)
+        {
+            const __m256i is_free = _mm256_cmpeq_epi16(_mm256_and_si256(map, column_mask), _mm256_setzero_si256());
+            const uint32_t bytes = uint32_t(_mm256_movemask_epi8(_mm256_packs_epi16(is_free, is_free)));
+            return (bytes & 0xff) | ((bytes >> 8) & 0xff00);
+        }
+    };
+
+    /// <summary>
+    /// AVX2 registers, with the AVX-512 mask compares (AVX512BW and AVX512VL): the free rows come out of one instruction.
+    /// </summary>
+    struct avx512
+    {
+        static constexpr const char* name = "AVX-512";
+        using vector_t = __m256i;
+
+        static __forceinline vector_t load(const board_map& map)
+        {
+            return avx2::load(map);
+        }
+
+        static __forceinline vector_t or_(const vector_t a, const vector_t b)
+        {
+            return avx2::or_(a, b);
+        }
+
+        static __forceinline uint32_t free_rows(const vector_t map, const vector_t column_mask)
+        {
+            return uint32_t(_mm256_testn_epi16_mask(map, column_mask));
+        }
+    };
+
+#ifdef _MSC_VER
+    // The bitwise operators the AVX2 engines use on __m256i, once for both. Microsoft's __m256i is a union, so it
+    // needs them; GCC and Clang have them built in for their vector types, and do not allow these.
+    namespace m256i_operators
+    {
+        // Bitwise equality.
+        __forceinline bool operator == (const __m256i a, const __m256i b)
+        {
+            return (0xffff'ffff == _mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)));
+        }
+
+        // Bitwise and.
+        __forceinline __m256i operator & (const __m256i a, const __m256i b)
+        {
+            return _mm256_and_si256(a, b);
+        }
+
+        // Bitwise or.
+        __forceinline __m256i operator | (const __m256i a, const __m256i b)
+        {
+            return _mm256_or_si256(a, b);
+        }
+    } // namespace m256i_operators
+#endif // _MSC_VER
+} // namespace simd
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <vector>
+
+#include "explicit_solution.h"
+#include "solution_stream.h"
+
+namespace qnsexplicit
+{
+    namespace
+    {
+        class bitset
+        {
+            std::vector<uint64_t> m_words;
+        public:
+            explicit bitset(uint64_t bits) : m_words(size_t((bits + 63) / 64), 0)
+            {
+            }
+
+            // Sets the bit; returns whether it was set already.
+            bool test_and_set(uint64_t bit)
+            {
+                uint64_t& word = m_words[size_t(bit / 64)];
+                const uint64_t mask = 1ULL << (bit % 64);
+                const bool was_set = (word & mask) != 0;
+                word |= mask;
+                return was_set;
+            }
+        };
+    } // anonymous namespace
+
+    void write(const std::string& path, uint32_t board_size)
+    {
+        packed::row_writer out(path, board_size);
+        for (uint32_t column = 0; column < board_size; ++column)
+        {
+            out.add(row(board_size, column));
+        }
+        out.close();
+    }
+
+    bool verify(const uint32_t* rows, uint32_t board_size)
+    {
+        bitset rows_taken(board_size);
+        bitset down_taken(2 * uint64_t(board_size)); // row - column + board_size
+        bitset up_taken(2 * uint64_t(board_size)); // row + column
+        for (uint32_t column = 0; column < board_size; ++column)
+        {
+            const uint64_t r = rows[column];
+            if (r >= board_size
+                || rows_taken.test_and_set(r)
+                || down_taken.test_and_set(r + board_size - column)
+                || up_taken.test_and_set(r + column))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace qnsexplicit
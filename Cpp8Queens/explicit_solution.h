@@ -0,0 +1,60 @@
+#pragma once
+
+// explicit_solution.h
+// One solution for any board from 4x4 up, with no search at all: the row of each column is a formula, one of three
+// depending on n mod 6 (Hoffman, Loessi and Moore, 1969; the version on Wikipedia's Eight queens puzzle page).
+// Evens first, then odds, with a few of them moved when n mod 6 is 2 or 3. O(1) per column, nothing held in memory.
+
+#include <cstdint>
+#include <string>
+
+namespace qnsexplicit
+{
+    constexpr uint32_t maximum_allowed_board_size = 100'000'000; // 400 MB written; the formula itself has no limit
+
+    /// <summary>
+    /// Row (from 0) of the queen in column (from 0) of the solution for board_size, 4 and up.
+    /// Rows 1 to n, in the order: 2, 4, ..., then 1, 3, ..., except
+    ///     n mod 6 == 2: the odds are 3, 1, 7, 9, ..., 5;
+    ///     n mod 6 == 3: the evens are 4, 6, ..., 2 and the odds 5, 7, ..., 1, 3.
+    /// </summary>
+    inline uint32_t row(uint32_t board_size, uint32_t column)
+    {
+        const uint32_t evens = board_size / 2;
+        const uint32_t odds = board_size - evens;
+        const uint32_t remainder = board_size % 6;
+        uint32_t one_based;
+        if (column < evens)
+        {
+            one_based = (remainder != 3) ? 2 * (column + 1)
+                : (column + 1 < evens) ? 2 * (column + 2) : 2;
+        }
+        else
+        {
+            const uint32_t j = column - evens;
+            if (remainder == 2)
+            {
+                one_based = (j == 0) ? 3 : (j == 1) ? 1 : (j + 1 == odds) ? 5 : 2 * j + 3;
+            }
+            else if (remainder == 3)
+            {
+                one_based = (j + 2 < odds) ? 2 * j + 5 : (j + 2 == odds) ? 1 : 3;
+            }
+            else
+            {
+                one_based = 2 * j + 1;
+            }
+        }
+        return one_based - 1;
+    }
+
+    // Writes the solution for board_size to path, a row at a time (packed::row_writer). Throws std::runtime_error
+    // if the file cannot be created.
+    void write(const std::string& path, uint32_t board_size);
+
+    /// <summary>
+    /// True if rows[0 .. board_size - 1] is a solution: one bit per row and per diagonal, each set once at most.
+    /// O(N) time, 5 N bits of memory.
+    /// </summary>
+    bool verify(const uint32_t* rows, uint32_t board_size);
+}
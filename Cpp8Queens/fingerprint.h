@@ -0,0 +1,77 @@
+#pragma once
+
+// fingerprint.h
+// Order independent fingerprint of a set of solutions: the sum, modulo 2^128, of a strong hash of each one.
+// Two engines that find the same solutions get the same fingerprint, whatever the order and the number of threads.
+
+#include <cstdint>
+#include <format>
+#include <string>
+
+#include "solution_stream.h"
+
+namespace fp
+{
+    constexpr int maximum_board_size = 16; // four bits a row, in one word
+
+    struct fingerprint
+    {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+
+        fingerprint& operator += (const fingerprint& that)
+        {
+            lo += that.lo;
+            hi += that.hi + (lo < that.lo ? 1 : 0); // carry
+            return *this;
+        }
+
+        bool operator == (const fingerprint& that) const = default;
+
+        std::string to_string() const
+        {
+            return std::format("{:016x}{:016x}", hi, lo);
+        }
+    };
+
+    // splitmix64 finalizer: a bijection, so distinct solutions never collide within one half.
+    __forceinline uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // Rows packed four bits each (boards up to 16x16); the board size goes into the seeds.
+    __forceinline fingerprint hash_solution(const int* rows, int board_size)
+    {
+        const uint64_t solution = packed::pack(rows, board_size);
+        return fingerprint{
+            mix(solution ^ (0x9e3779b97f4a7c15ULL * uint64_t(board_size))),
+            mix(solution + (0xc2b2ae3d27d4eb4fULL * uint64_t(board_size + 1)))
+        };
+    }
+
+    /// <summary>
+    /// Adds a solution found by a half board search, and its mirror image (row r becomes row n - 1 - r),
+    /// which the search never visits. Not when the first queen is in the middle row of an odd board:
+    /// that mirror image starts in the middle row too, and the search finds it on its own.
+    /// Boards up to maximum_board_size only: engines that go further must not fold their bigger solutions.
+    /// </summary>
+    __forceinline void fold(fingerprint& into, const int* rows, int board_size)
+    {
+        into += hash_solution(rows, board_size);
+        if (2 * rows[0] + 1 != board_size)
+        {
+            int mirrored[maximum_board_size];
+            for (int column = 0; column < board_size; ++column)
+            {
+                mirrored[column] = board_size - 1 - rows[column];
+            }
+            into += hash_solution(mirrored, board_size);
+        }
+    }
+} // namespace fp
@@ -0,0 +1,254 @@
+#define _CRT_SECURE_NO_WARNINGS  // We do NOT support Microsoft's War on Standards.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "first_solutions.h"
+#include "high_res_clock.h"
+#include "thread_pool.h"
+
+namespace qnsfirst
+{
+    namespace
+    {
+        // Free rows, one mask per column. Only the columns still empty are kept up to date.
+        using columns_t = std::array<uint64_t, maximum_allowed_board_size>;
+
+        // One search, every thread.
+        struct shared_state
+        {
+            int board_size = 0;
+            int wanted = 0;
+            std::vector<int> middle_first; // every row, the ones closest to the middle first
+            std::atomic<bool> stop = false; // read at every node: relaxed, it is only ever set once
+            std::atomic<int> found = 0; // may go past wanted, by one per thread at most
+            std::vector<std::vector<int>> solutions; // one per index claimed from found, each written by its own thread
+        };
+
+        // Rows closest to the middle of the board first: 3, 4, 2, 5, 1, 6, 0, 7 for 8x8.
+        std::vector<int> middle_first_rows(int board_size)
+        {
+            std::vector<int> result;
+            result.reserve(board_size);
+            for (int distance = 0; int(result.size()) < board_size; ++distance)
+            {
+                const int below = (board_size - 1) / 2 - distance;
+                const int above = board_size / 2 + distance;
+                if (0 <= below)
+                {
+                    result.push_back(below);
+                }
+                if (above != below && above < board_size)
+                {
+                    result.push_back(above);
+                }
+            }
+            return result;
+        }
+
+        // Queen on (row, column): take what she attacks out of every empty column.
+        inline void place(columns_t& free, uint64_t columns_left, int row, int column)
+        {
+            const uint64_t row_bit = 1ULL << row;
+            for (uint64_t left = columns_left; left; left &= left - 1)
+            {
+                const int other = std::countr_zero(left);
+                const int distance = std::abs(other - column); // 1 to 63
+                free[other] &= ~(row_bit | (row_bit << distance) | (row_bit >> distance));
+            }
+        }
+
+        /// <summary>
+        /// One thread's share: some of the rows of the first column, the middle one. Functor for the thread pool.
+        /// </summary>
+        class search_slice
+        {
+            shared_state& m_shared;
+            std::vector<int> m_first_rows;
+            std::vector<int> m_rows; // the current partial solution, by column
+            unsigned long long m_nodes = 0;
+
+            void record_solution()
+            {
+                const int index = m_shared.found.fetch_add(1);
+                if (index < m_shared.wanted)
+                {
+                    m_shared.solutions[index] = m_rows;
+                }
+                if (index + 1 >= m_shared.wanted)
+                {
+                    m_shared.stop.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            void do_search(const columns_t& free, uint64_t columns_left)
+            {
+                if (!columns_left)
+                {
+                    record_solution();
+                    return;
+                }
+
+                // The most constrained column; between equals, the one closest to the middle.
+                const int board_size = m_shared.board_size;
+                int column = -1;
+                int fewest = maximum_allowed_board_size + 1;
+                int closest = 2 * maximum_allowed_board_size;
+                for (uint64_t left = columns_left; left; left &= left - 1)
+                {
+                    const int c = std::countr_zero(left);
+                    const int free_count = std::popcount(free[c]);
+                    if (free_count == 0)
+                    {
+                        return; // dead end
+                    }
+                    const int from_middle = std::abs(2 * c - (board_size - 1));
+                    if (free_count < fewest || (free_count == fewest && from_middle < closest))
+                    {
+                        column = c;
+                        fewest = free_count;
+                        closest = from_middle;
+                    }
+                }
+
+                const uint64_t columns_after = columns_left & ~(1ULL << column);
+                for (int row : m_shared.middle_first)
+                {
+                    if (!(free[column] & (1ULL << row)))
+                    {
+                        continue; // for
+                    }
+                    if (m_shared.stop.load(std::memory_order_relaxed))
+                    {
+                        break; // for
+                    }
+                    columns_t next = free;
+                    place(next, columns_after, row, column);
+                    m_rows[column] = row;
+                    ++m_nodes;
+                    do_search(next, columns_after);
+                }
+                // Leave things as they were.
+                m_rows[column] = -1;
+            }
+
+        public:
+            search_slice(shared_state& shared, std::vector<int> first_rows) :
+                m_shared(shared),
+                m_first_rows(std::move(first_rows)),
+                m_rows(shared.board_size, -1)
+            {
+            }
+
+            void operator()()
+            {
+                const int board_size = m_shared.board_size;
+                const int first_column = (board_size - 1) / 2;
+                const uint64_t all_rows = (board_size == 64) ? ~0ULL : ((1ULL << board_size) - 1);
+                const uint64_t all_columns = all_rows; // same board
+                const uint64_t columns_after = all_columns & ~(1ULL << first_column);
+                for (int row : m_first_rows)
+                {
+                    if (m_shared.stop.load(std::memory_order_relaxed))
+                    {
+                        break; // for
+                    }
+                    columns_t free;
+                    free.fill(all_rows);
+                    place(free, columns_after, row, first_column);
+                    m_rows[first_column] = row;
+                    ++m_nodes;
+                    do_search(free, columns_after);
+                }
+                m_rows[first_column] = -1;
+            }
+
+            unsigned long long nodes() const { return m_nodes; }
+        };
+    } // anonymous namespace
+
+    result find_first(int board_size, int wanted)
+    {
+        result found;
+        if (board_size < 4 || board_size > maximum_allowed_board_size)
+        {
+            std::cout << "Size must be between 4 and " << maximum_allowed_board_size << ", it is " << board_size << ". Doing nothing." << std::endl;
+            return found;
+        }
+        if (wanted < 1)
+        {
+            return found;
+        }
+
+        shared_state shared;
+        shared.board_size = board_size;
+        shared.wanted = wanted;
+        shared.middle_first = middle_first_rows(board_size);
+        shared.solutions.assign(size_t(wanted), std::vector<int>(board_size, -1));
+
+        // Every thread gets rows of the first column from all over the middle_first order, so that every
+        // thread starts with a promising one.
+        const int n_threads = std::max(1, (int)std::thread::hardware_concurrency());
+        std::vector<std::vector<int>> first_rows(n_threads);
+        for (int i = 0; i < board_size; ++i)
+        {
+            first_rows[i % n_threads].push_back(shared.middle_first[i]);
+        }
+        std::vector<search_slice> slices;
+        slices.reserve(n_threads);
+        for (int i_thread = 0; i_thread < n_threads; ++i_thread)
+        {
+            slices.emplace_back(shared, std::move(first_rows[i_thread]));
+        }
+
+        // Starting the threads is part of the wait for an answer, so it is timed too.
+        hi_res_timer timer;
+        if (n_threads < 2)
+        {
+            slices[0](); // the thread pool wants two threads at least
+        }
+        else
+        {
+            ThreadPool<search_slice> pool;
+            for (int i_thread = 0; i_thread < n_threads; ++i_thread)
+            {
+                pool.push(&slices[i_thread]);
+            }
+            pool.wait_all();
+        }
+        timer.Stop();
+
+        found.microseconds = timer.GetElapsedMicroseconds();
+        for (const search_slice& slice : slices)
+        {
+            found.nodes += slice.nodes();
+        }
+        shared.solutions.resize(std::min<size_t>(size_t(wanted), size_t(shared.found.load())));
+        found.solutions = std::move(shared.solutions);
+        return found;
+    }
+
+    bool is_solution(const std::vector<int>& rows)
+    {
+        const int board_size = int(rows.size());
+        std::vector<bool> row_taken(board_size, false);
+        std::vector<bool> down_taken(2 * size_t(board_size), false); // row - column + board_size
+        std::vector<bool> up_taken(2 * size_t(board_size), false); // row + column
+        for (int column = 0; column < board_size; ++column)
+        {
+            const int row = rows[column];
+            if (row < 0 || row >= board_size || row_taken[row] || down_taken[row - column + board_size] || up_taken[row + column])
+            {
+                return false;
+            }
+            row_taken[row] = down_taken[row - column + board_size] = up_taken[row + column] = true;
+        }
+        return true;
+    }
+} // namespace qnsfirst
@@ -0,0 +1,29 @@
+#pragma once
+
+// first_solutions.h
+// The first few solutions, not all of them, for boards up to 64x64. Every thread stops as soon as enough have been
+// found between them. The columns are not filled left to right: the next one is the column with the fewest free rows,
+// and its rows are tried middle first, where solutions are more common. A dead end shows up as a column with none.
+
+#include <vector>
+
+namespace qnsfirst
+{
+    constexpr int maximum_allowed_board_size = 64; // one uint64_t of free rows per column
+
+    struct result
+    {
+        std::vector<std::vector<int>> solutions; // rows by column, as every engine has them; in the order found
+        unsigned long long nodes = 0; // queens placed, all threads
+        double microseconds = 0.0;
+    };
+
+    /// <summary>
+    /// Up to wanted solutions for a board_size by board_size board (4 to 64), fewer only if there are not that many.
+    /// Multithreaded; which solutions come back, and in which order, may change from run to run.
+    /// </summary>
+    result find_first(int board_size, int wanted);
+
+    // One queen per row and column, none on a diagonal with another.
+    bool is_solution(const std::vector<int>& rows);
+}
@@ -0,0 +1,84 @@
+#include <iomanip>
+#include <iostream>
+
+#include "golden.h"
+#include "high_res_clock.h"
+
+namespace golden
+{
+    namespace
+    {
+        // https://oeis.org/A000170
+        const unsigned long long known_totals[] = {
+            2,          // 4
+            10,         // 5
+            4,          // 6
+            40,         // 7
+            92,         // 8
+            352,        // 9
+            724,        // 10
+            2'680,      // 11
+            14'200,     // 12
+            73'712,     // 13
+            365'596,    // 14
+            2'279'184,  // 15
+            14'772'512, // 16
+        };
+        static_assert(sizeof(known_totals) / sizeof(known_totals[0]) == last_known_size - first_known_size + 1, "One total per size.");
+    } // anonymous namespace
+
+    unsigned long long expected(int board_size)
+    {
+        if (board_size < first_known_size || board_size > last_known_size)
+        {
+            return 0;
+        }
+        return known_totals[board_size - first_known_size];
+    }
+
+    unsigned long long total(int board_size, count_fn count, fingerprint_fn fingerprint, fp::fingerprint* whole)
+    {
+        const bool fingerprinted = (fingerprint && whole);
+        if (fingerprinted)
+        {
+            *whole = fp::fingerprint();
+        }
+        const int half = board_size / 2;
+        unsigned long long result = 2 * count(0, half);
+        if (fingerprinted)
+        {
+            *whole += fingerprint(); // mirror images included
+        }
+        if (board_size % 2)
+        {
+            result += count(half, half + 1);
+            if (fingerprinted)
+            {
+                *whole += fingerprint();
+            }
+        }
+        return result;
+    }
+
+    bool check(const char* engine, int board_size, count_fn count, fingerprint_fn fingerprint, fp::fingerprint* whole)
+    {
+        hi_res_timer timer;
+        const unsigned long long found = total(board_size, count, fingerprint, whole);
+        const unsigned long long wanted = expected(board_size);
+        const bool pass = (found == wanted);
+        std::cout << (pass ? "PASS " : "FAIL ") << std::left << std::setw(20) << engine << std::right
+            << " n = " << std::setw(2) << board_size
+            << ": " << std::setw(10) << found << " solutions";
+        if (!pass)
+        {
+            std::cout << ", expected " << wanted;
+        }
+        if (fingerprint && whole)
+        {
+            std::cout << ", fingerprint " << whole->to_string();
+        }
+        std::cout << " (" << std::fixed << std::setprecision(1) << timer.GetElapsedMicroseconds() / 1000.0 << " ms)"
+            << std::defaultfloat << std::setprecision(6) << std::endl;
+        return pass;
+    }
+} // namespace golden
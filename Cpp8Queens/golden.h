@@ -0,0 +1,26 @@
+#pragma once
+
+// golden.h
+// Self test: count-only solves of every board size an engine supports, checked against the published totals.
+
+#include "fingerprint.h"
+
+namespace golden
+{
+    using count_fn = unsigned long long(*)(int first_row, int end_row);
+    using fingerprint_fn = fp::fingerprint(*)(); // of the engine's last count
+
+    constexpr int first_known_size = 4;
+    constexpr int last_known_size = 16;
+
+    // Total number of solutions for a board_size x board_size board, 0 outside [first_known_size, last_known_size].
+    unsigned long long expected(int board_size);
+
+    // Engines search half the board: a solution with the first queen in row r mirrors one with it in row n - 1 - r.
+    // The middle row of an odd board is its own mirror, so it is counted once.
+    // Given fingerprint and whole, also sums the fingerprints of both searches into whole.
+    unsigned long long total(int board_size, count_fn count, fingerprint_fn fingerprint = nullptr, fp::fingerprint* whole = nullptr);
+
+    // Prints one PASS or FAIL line, with the fingerprint when asked for; the engine must already be set to board_size.
+    bool check(const char* engine, int board_size, count_fn count, fingerprint_fn fingerprint = nullptr, fp::fingerprint* whole = nullptr);
+} // namespace golden
@@ -1,101 +1,90 @@
-#ifdef USE_WINAPI_FOR_8QUEENS_TIMER
 /*
 
-From https://docs.microsoft.com/en-us/windows/win32/sysinfo/acquiring-high-resolution-time-stamps#examples-for-acquiring-time-stamps
-Unfortunately, std::chrono::high_resolution_clock is low-resolution for some older versions of Visual C++.
+The time stamp counter runs at a constant rate on anything built in the last fifteen years (invariant TSC),
+whatever the current core frequency. We only need to know that rate, once.
 
-A standards-based implementation is available below for reference.
+Earlier versions used QueryPerformanceCounter, then std::chrono::high_resolution_clock, with a heap
+allocated pimpl per timer. Fine for 16x16, hopeless for 4x4, where a whole solve takes about a microsecond.
 
 */
 
-#include <windows.h>
-#include <profileapi.h>
-
-#include "high_res_clock.h"
-
-class hi_res_timer::TimerData
-{
-	LARGE_INTEGER StartingTime;
-	LARGE_INTEGER Frequency;
-	LARGE_INTEGER EndingTime;
-	LARGE_INTEGER ElapsedMicroseconds;
-public:
-	TimerData()
-	{
-		QueryPerformanceFrequency(&Frequency);
-		QueryPerformanceCounter(&StartingTime);
-	}
-	~TimerData() = default;
-	void Stop()
-	{
-		QueryPerformanceCounter(&EndingTime);
-		ElapsedMicroseconds.QuadPart = EndingTime.QuadPart - StartingTime.QuadPart;
-		//
-		// We now have the elapsed number of ticks, along with the
-		// number of ticks-per-second. We use these values
-		// to convert to the number of elapsed microseconds.
-		// To guard against loss-of-precision, we convert
-		// to microseconds *before* dividing by ticks-per-second.
-		//
-
-		ElapsedMicroseconds.QuadPart *= 1000000;
-		ElapsedMicroseconds.QuadPart /= Frequency.QuadPart;
-	}
-	microsecs_t GetElapsedMicroseconds() const
-	{
-		return microsecs_t(ElapsedMicroseconds.QuadPart);
-	}
-
-};
-#else // USE_WINAPI_FOR_8QUEENS_TIMER
 #include <chrono>
+#include <iostream>
+#include <iomanip>
+
 #include "high_res_clock.h"
 
-class hi_res_timer::TimerData
+namespace tsc
 {
-	using Clock = std::chrono::high_resolution_clock;
-	const Clock::time_point m_begin = Clock::now();
-	microsecs_t m_duration = microsecs_t(-1);
-public:
-	TimerData() = default;
-	void Stop()
-	{
-		const auto end_ = Clock::now();
-		using std::chrono::nanoseconds;
-		using std::chrono::duration_cast;
-		auto ns = duration_cast<nanoseconds>(end_ - m_begin);
-		m_duration = microsecs_t(double(ns.count()) / 1000.0);
-	}
-	microsecs_t GetElapsedMicroseconds() const
-	{
-		return microsecs_t(m_duration);
-	}
-};
+    namespace
+    {
+        double calibrate()
+        {
+            using Clock = std::chrono::steady_clock;
+            // Spin, don't sleep: a sleeping core may not come back in time.
+            auto measure = [](std::chrono::microseconds how_long) {
+                const auto begin = Clock::now();
+                const ticks_t ticks_begin = now();
+                while (Clock::now() - begin < how_long)
+                {
+                    // spin
+                }
+                const ticks_t ticks_end = now();
+                const auto end = Clock::now();
+                const double microseconds = std::chrono::duration<double, std::micro>(end - begin).count();
+                return double(ticks_end - ticks_begin) / microseconds;
+            };
+            measure(std::chrono::microseconds(1'000)); // warm up
+            // Highest of three. The ticks are read inside the clock's window, so an interruption between the reads
+            // adds clock time without ticks: it can only make a sample's rate lower.
+            double best = 0.0;
+            for (int i = 0; i < 3; ++i)
+            {
+                const double rate = measure(std::chrono::microseconds(10'000));
+                if (rate > best)
+                {
+                    best = rate;
+                }
+            }
+            return best;
+        }
 
-#endif // USE_WINAPI_FOR_8QUEENS_TIMER
+        const char* const phase_names[] = { "setup", "search", "merge", "output" };
+        static_assert(sizeof(phase_names) / sizeof(phase_names[0]) == size_t(phase::count), "One name per phase.");
 
-hi_res_timer::hi_res_timer()
-{
-	m_Data = new TimerData;
-	running = true;
-}
+        // Calibrate at startup, not in the middle of the first measurement.
+        [[maybe_unused]] const double startup_rate = ticks_per_microsecond();
+    } // anonymous namespace
 
-hi_res_timer::~hi_res_timer()
-{
-	delete m_Data;
-}
+    double ticks_per_microsecond()
+    {
+        static const double rate = calibrate();
+        return rate;
+    }
 
-void hi_res_timer::Stop()
-{
-	m_Data->Stop();
-	running = false;
-}
+    void reset_phases()
+    {
+        phase_ticks.fill(0);
+    }
 
-hi_res_timer::microsecs_t hi_res_timer::GetElapsedMicroseconds()
-{
-	if (running)
-	{
-		Stop();
-	}
-	return m_Data->GetElapsedMicroseconds();
-}
+    void print_phases()
+    {
+        ticks_t total = 0;
+        for (ticks_t ticks : phase_ticks)
+        {
+            total += ticks;
+        }
+        if (total == 0)
+        {
+            return;
+        }
+        std::cout << "Time by phase:";
+        for (size_t i = 0; i < phase_ticks.size(); ++i)
+        {
+            std::cout << " " << phase_names[i] << " " << std::fixed << std::setprecision(1)
+                << to_microseconds(phase_ticks[i]) << " us (" << 100.0 * double(phase_ticks[i]) / double(total) << "%)"
+                << (i + 1 < phase_ticks.size() ? "," : ".");
+        }
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+} // namespace tsc
@@ -1,19 +1,102 @@
 #pragma once
 
+// high_res_clock.h
+// Time stamp counter based timing. Everything inline and on the stack: no allocation inside benchmark loops.
+// The TSC frequency is calibrated once, at startup, against std::chrono::steady_clock (see high_res_clock.cpp).
+
+#include <array>
+#include <cstdint>
+
+#include <intrin.h>
+
+namespace tsc
+{
+    using ticks_t = uint64_t;
+
+    // rdtscp waits for earlier instructions to finish; the lfence keeps later ones from starting early.
+    __forceinline ticks_t now()
+    {
+        unsigned int aux;
+        const ticks_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+    }
+
+    double ticks_per_microsecond(); // calibrated once
+
+    inline double to_microseconds(ticks_t ticks)
+    {
+        return double(ticks) / ticks_per_microsecond();
+    }
+
+    // Where the time goes, for a whole solve.
+    enum class phase
+    {
+        setup,
+        search,
+        merge,
+        output,
+        count
+    };
+
+    // Per thread, self time only: a nested span's time goes to its own phase, not to the enclosing one's.
+    inline thread_local std::array<ticks_t, size_t(phase::count)> phase_ticks{};
+
+    void reset_phases();
+    void print_phases(); // this thread's
+
+    /// <summary>
+    /// Scoped timing span. Nest them freely:
+    ///     tsc::span s(tsc::phase::search);
+    /// </summary>
+    class span
+    {
+        static inline thread_local span* innermost = nullptr;
+
+        span* const m_parent;
+        const phase m_phase;
+        ticks_t m_children = 0;
+        const ticks_t m_start;
+    public:
+        explicit span(phase p) : m_parent(innermost), m_phase(p), m_start(now())
+        {
+            innermost = this;
+        }
+        ~span()
+        {
+            const ticks_t elapsed = now() - m_start;
+            phase_ticks[size_t(m_phase)] += elapsed - m_children;
+            if (m_parent)
+            {
+                m_parent->m_children += elapsed;
+            }
+            innermost = m_parent;
+        }
+        span(const span&) = delete;
+        span& operator = (const span&) = delete;
+    };
+} // namespace tsc
+
 class hi_res_timer
 {
-	class TimerData; // forward declaration
-	TimerData* m_Data;
-	bool running = false;
+	const tsc::ticks_t m_start = tsc::now();
+	tsc::ticks_t m_end = 0;
+	bool running = true;
 public:
-	hi_res_timer();
-	~hi_res_timer();
-	void Stop();
-#if _MSC_VER < 1930 // or if def _MSC_VER, depending...
-	using microsecs_t = long long;
-#define USE_WINAPI_FOR_8QUEENS_TIMER
-#else 
+	hi_res_timer() = default;
+	~hi_res_timer() = default;
+	void Stop()
+	{
+		m_end = tsc::now();
+		running = false;
+	}
 	using microsecs_t = double;
-#endif 
-	microsecs_t GetElapsedMicroseconds();
+	microsecs_t GetElapsedMicroseconds()
+	{
+		if (running)
+		{
+			Stop();
+		}
+		return tsc::to_microseconds(m_end - m_start);
+	}
 };
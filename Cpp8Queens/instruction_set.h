@@ -0,0 +1,9 @@
+#pragma once
+
+// instruction_set.h
+// What InstructionSet.cpp tells the rest of the program about the processor, for the benchmark baselines.
+
+#include <string>
+
+std::string cpu_brand();
+std::string isa_flags(); // the extensions the engines care about, space separated
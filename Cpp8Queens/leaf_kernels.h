@@ -0,0 +1,61 @@
+#pragma once
+
+// leaf_kernels.h
+// The last three columns, without recursion. Most nodes of the search tree are down there, and each one costs
+// a threaten(), a not_threatened_rows() vector fill and a call. With the free rows of each of those columns as
+// bit masks, taken from the map before placing anything in them, the rest is shifts, ANDs and a popcount.
+
+#include <bit>
+#include <cstdint>
+
+namespace leaf
+{
+    struct outcome
+    {
+        uint32_t solutions = 0;
+        uint32_t dead_ends = 0; // queens placed with nowhere to go in the next column
+    };
+
+    // Rows attacked d columns away by queens on the rows of row_bits, along both diagonals.
+    __forceinline uint32_t diagonals(uint32_t row_bits, int d)
+    {
+        return (row_bits << d) | (row_bits >> d);
+    }
+
+    /// <summary>
+    /// Every completion of the last three columns. first, second and third are the rows free in each of them,
+    /// as threatened by the queens already placed; the kernel adds what its own queens threaten.
+    /// on_solution(row, row, row) is called for each completion; pass a lambda that does nothing to just count,
+    /// the compiler then drops the row numbers altogether.
+    /// </summary>
+    template<typename on_solution_t>
+    __forceinline outcome last_three_columns(uint32_t first, uint32_t second, uint32_t third, on_solution_t&& on_solution)
+    {
+        outcome result;
+        for (uint32_t first_left = first; first_left; first_left &= first_left - 1)
+        {
+            const uint32_t a = first_left & (0u - first_left);
+            const uint32_t second_fits = second & ~(a | diagonals(a, 1));
+            if (!second_fits)
+            {
+                ++result.dead_ends;
+                continue; // for
+            }
+            const uint32_t third_free = third & ~(a | diagonals(a, 2));
+            for (uint32_t second_left = second_fits; second_left; second_left &= second_left - 1)
+            {
+                const uint32_t b = second_left & (0u - second_left);
+                // One row is left by now, so at most one bit.
+                const uint32_t third_fits = third_free & ~(b | diagonals(b, 1));
+                if (!third_fits)
+                {
+                    ++result.dead_ends;
+                    continue; // for
+                }
+                result.solutions += std::popcount(third_fits);
+                on_solution(std::countr_zero(a), std::countr_zero(b), std::countr_zero(third_fits));
+            }
+        }
+        return result;
+    }
+} // namespace leaf
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <bit>
+
+#include "leaf_table.h"
+
+namespace leaves
+{
+    table::table(int board_size, int columns) : m_board_size(board_size), m_columns(std::clamp(columns, 1, board_size - 1))
+    {
+        struct placement
+        {
+            uint32_t rows;
+            uint32_t down;
+            uint32_t up;
+        };
+        std::vector<placement> found;
+        const uint32_t all = bits::all_rows(board_size);
+
+        // The last columns on an empty board: queens that do not attack each other. A queen j columns in, on row r,
+        // is attacked by a main diagonal coming in on row r - j, and by a second diagonal coming in on row r + j.
+        auto visit = [&](auto&& self, const bits::state& s, int column, uint32_t down, uint32_t up) -> void {
+            if (column == m_columns)
+            {
+                found.push_back(placement{ s.rows, down, up });
+                return;
+            }
+            for (uint32_t candidates = bits::free_rows(s, all); candidates; candidates &= candidates - 1)
+            {
+                const uint32_t row_bit = candidates & (0u - candidates);
+                self(self, bits::place(s, row_bit), column + 1, down | (row_bit >> column), up | ((row_bit << column) & all));
+            }
+        };
+        visit(visit, bits::state(), 0, 0, 0);
+
+        // Counting sort on the rows used.
+        m_first.assign(size_t(all) + 2, 0);
+        for (const placement& p : found)
+        {
+            ++m_first[size_t(p.rows) + 1];
+        }
+        for (size_t i = 1; i < m_first.size(); ++i)
+        {
+            m_first[i] += m_first[i - 1];
+        }
+        std::vector<uint32_t> next(m_first.begin(), m_first.end() - 1);
+        m_down.resize(found.size());
+        m_up.resize(found.size());
+        for (const placement& p : found)
+        {
+            const uint32_t i = next[p.rows]++;
+            m_down[i] = p.down;
+            m_up[i] = p.up;
+        }
+    }
+} // namespace leaves
@@ -0,0 +1,47 @@
+#pragma once
+
+// left_pack.h
+// From a mask of free rows to the list of their numbers, with no branches: one table lookup and one 8 byte store
+// per 8 rows, the second store starting where the first one's rows end. The table is the shuffle control that
+// would left-pack the identity vector 0, 1, ..., 7, so it is also the answer, no shuffle needed.
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace lpack
+{
+    // Entry m: the positions of the bits set in m, lowest first, one per byte. The bytes after those are zero.
+    constexpr std::array<uint64_t, 256> byte_positions = [] {
+        std::array<uint64_t, 256> A = {};
+        for (unsigned m = 0; m < 256; ++m)
+        {
+            int j = 0;
+            for (unsigned bit = 0; bit < 8; ++bit)
+            {
+                if (m & (1u << bit))
+                {
+                    A[m] |= uint64_t(bit) << (8 * j++);
+                }
+            }
+        }
+        return A;
+    }();
+
+    /// <summary>
+    /// Writes the numbers of the bits set in the low 16 bits of mask to out, in increasing order, and returns how many.
+    /// out must have room for 16: both halves are stored whole.
+    /// </summary>
+    __forceinline int left_pack(uint32_t mask, int8_t* out)
+    {
+        const uint32_t low = mask & 0xff;
+        const uint32_t high = (mask >> 8) & 0xff;
+        const int low_count = std::popcount(low);
+        const uint64_t low_rows = byte_positions[low];
+        const uint64_t high_rows = byte_positions[high] + 0x0808'0808'0808'0808ULL; // rows 8 to 15
+        memcpy(out, &low_rows, sizeof(low_rows));
+        memcpy(out + low_count, &high_rows, sizeof(high_rows));
+        return low_count + std::popcount(high);
+    }
+} // namespace lpack
@@ -0,0 +1,99 @@
+#pragma once
+
+// microbench.h
+// Kernel-level timing: threaten, is_totally_under_threat, not_threatened_rows and friends, one call at a time.
+// Each engine samples its own board states (random partial placements, as the search really sees them)
+// and times its own primitives with these helpers.
+
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "high_res_clock.h"
+
+namespace bench
+{
+    // A board as the search sees it: the threats so far, and a legal queen for the next column.
+    template <typename Map>
+    struct kernel_state
+    {
+        Map map;
+        int row;
+        int column;
+    };
+
+    /// <summary>
+    /// Random partial placements, at random depths: realistic inputs for the kernels.
+    /// Each engine brings its own map type and primitives.
+    /// </summary>
+    template <typename Map, typename IsFree, typename Threaten>
+    std::vector<kernel_state<Map>> random_kernel_states(const Map& starting_map, int board_size, size_t count, IsFree is_free, Threaten threaten)
+    {
+        std::mt19937 generator(8);
+        std::vector<kernel_state<Map>> states;
+        states.reserve(count);
+        while (states.size() < count)
+        {
+            Map map = starting_map;
+            const int depth = std::uniform_int_distribution<int>(0, board_size - 2)(generator);
+            for (int column = 0; column <= depth && states.size() < count; ++column)
+            {
+                std::vector<int> free_rows;
+                for (int row = 0; row < board_size; ++row)
+                {
+                    if (is_free(map, row, column))
+                    {
+                        free_rows.push_back(row);
+                    }
+                }
+                if (free_rows.empty())
+                {
+                    break; // for
+                }
+                const int row = free_rows[std::uniform_int_distribution<size_t>(0, free_rows.size() - 1)(generator)];
+                states.push_back(kernel_state<Map>{ map, row, column });
+                map = threaten(map, row, column);
+            }
+        }
+        return states;
+    }
+
+    // Keeps the optimizer from throwing away the calls we time.
+    inline volatile uint64_t kernel_sink = 0;
+
+    /// <summary>
+    /// Time stamp counter cycles per call of kernel(state), over every state; best of several passes.
+    /// </summary>
+    /// <param name="kernel">Returns something that fits in 64 bits; it is folded into kernel_sink.</param>
+    template <typename State, typename Kernel>
+    double cycles_per_call(const std::vector<State>& states, Kernel kernel, int passes = 7)
+    {
+        double best = 1e300;
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            uint64_t folded = 0;
+            const uint64_t start = tsc::now();
+            for (const State& state : states)
+            {
+                folded += uint64_t(kernel(state));
+            }
+            const uint64_t end = tsc::now();
+            kernel_sink = kernel_sink + folded;
+            const double per_call = double(end - start) / double(states.size());
+            if (per_call < best)
+            {
+                best = per_call;
+            }
+        }
+        return best;
+    }
+
+    inline void print_kernel(const char* engine, const char* kernel, double cycles)
+    {
+        std::cout << std::setw(20) << engine << "  " << std::setw(36) << std::left << kernel << std::right
+            << std::fixed << std::setprecision(2) << std::setw(8) << cycles << " TSC cycles per call" << std::endl
+            << std::defaultfloat << std::setprecision(6);
+    }
+} // namespace bench
@@ -0,0 +1,28 @@
+#pragma once
+
+// min_conflicts.h
+// One solution for boards far too big to search, 1'000 to 1'000'000 columns and more: local search, not backtracking.
+// One queen per column from the start. Queens that attack others are moved, one at a time, to the row of their column
+// with the fewest attackers, until there are none. Conflicts are counted in flat arrays, one counter per row and per
+// diagonal, so memory is O(N) and checking a cell is three loads.
+
+#include <cstdint>
+#include <vector>
+
+namespace qnsmc
+{
+    struct result
+    {
+        std::vector<int> rows; // by column; the last board tried if not solved
+        bool solved = false;
+        uint64_t moves = 0; // queens moved after the initial placement, all restarts
+        int restarts = 0;
+        double microseconds = 0.0;
+    };
+
+    /// <summary>
+    /// One solution for a board_size by board_size board (4 and up), found with seed; the same seed, the same solution.
+    /// Gives up after max_restarts restarts, each of them allowed max_moves moves.
+    /// </summary>
+    result solve(int board_size, uint64_t seed, uint64_t max_moves = 10'000, int max_restarts = 100);
+}
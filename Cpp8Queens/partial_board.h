@@ -0,0 +1,66 @@
+#pragma once
+
+// partial_board.h
+// A board with some of the work done: queens already placed, and cells where no queen may go.
+// A completion query asks for the ways of filling the other columns. The search starts from a threats map with all
+// of that folded in, and never visits the fixed columns, so the more is fixed, the less there is to search.
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace partial
+{
+    struct cell
+    {
+        int row;
+        int column;
+    };
+
+    struct board
+    {
+        int board_size = 8;
+        std::vector<cell> queens; // at most one per column
+        std::vector<cell> blocked; // empty, and no queen may go there
+    };
+
+    constexpr int maximum_coordinate = 15; // no board takes more than 16x16
+
+    namespace detail
+    {
+        // Digits only, 0 to maximum_coordinate, nothing left over.
+        inline bool parse_coordinate(std::string_view text, int& value)
+        {
+            if (text.empty() || !isdigit((unsigned char)text[0]))
+            {
+                return false;
+            }
+            const std::from_chars_result parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+            return parsed.ec == std::errc() && parsed.ptr == text.data() + text.size() && value <= maximum_coordinate;
+        }
+    }
+
+    // One cell as -q and the daemon take it: q3,0 is a queen on row 3, column 0, x5,5 a blocked cell, either case.
+    // kind is 'q' or 'x'. False for anything else: a number out of range, trailing characters, a missing comma.
+    inline bool parse_cell(std::string_view text, char& kind, cell& out)
+    {
+        const size_t comma = text.find(',');
+        if (text.size() < 2 || comma == std::string_view::npos)
+        {
+            return false;
+        }
+        kind = char(tolower((unsigned char)text[0]));
+        return (kind == 'q' || kind == 'x')
+            && detail::parse_coordinate(text.substr(1, comma - 1), out.row)
+            && detail::parse_coordinate(text.substr(comma + 1), out.column);
+    }
+
+    struct completions
+    {
+        bool valid = false; // false: a cell off the board, two queens in a column or attacking each other, or a queen on a blocked cell
+        uint64_t count = 0; // every completion, fixed queens included
+        std::vector<std::vector<int>> solutions; // the first ones found, rows by column, up to the number asked for
+    };
+}
@@ -0,0 +1,151 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace perf
+{
+    const char* name(counter c)
+    {
+        static const char* const names[] = { "cycles", "instructions", "branch_misses", "l1d_misses", "frontend_stalls" };
+        static_assert(sizeof(names) / sizeof(names[0]) == counter_count, "One name per counter.");
+        return names[size_t(c)];
+    }
+
+#ifdef __linux__
+    namespace
+    {
+        int open_counter(counter c)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = 1;
+            attr.inherit = 1;         // Threads started later count too. Rules out PERF_FORMAT_GROUP, hence one fd each.
+            attr.exclude_kernel = 1;  // Allowed up to perf_event_paranoid 2.
+            attr.exclude_hv = 1;
+            switch (c)
+            {
+            case counter::cycles:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case counter::instructions:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case counter::branch_misses:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case counter::l1d_misses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case counter::frontend_stalls:
+                // Not exposed as a generic event on many Intel parts; then this one is unavailable.
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;
+                break;
+            default:
+                return -1;
+            }
+            return int(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1 /* no group */, 0));
+        }
+    } // anonymous namespace
+
+    counters::counters()
+    {
+        for (size_t i = 0; i < counter_count; ++i)
+        {
+            m_fds[i] = open_counter(counter(i));
+        }
+    }
+
+    counters::~counters()
+    {
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    bool counters::available() const
+    {
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void counters::start()
+    {
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    readings counters::stop()
+    {
+        readings r;
+        for (int fd : m_fds)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (size_t i = 0; i < counter_count; ++i)
+        {
+            uint64_t value = 0;
+            if (m_fds[i] >= 0 && read(m_fds[i], &value, sizeof(value)) == sizeof(value))
+            {
+                r.values[i] = value;
+                r.valid[i] = true;
+            }
+        }
+        return r;
+    }
+#else
+    // No perf_event_open here: nothing to count, nothing to fail.
+    counters::counters()
+    {
+        m_fds.fill(-1);
+    }
+
+    counters::~counters() = default;
+
+    bool counters::available() const
+    {
+        return false;
+    }
+
+    void counters::start()
+    {
+    }
+
+    readings counters::stop()
+    {
+        return readings();
+    }
+#endif // __linux__
+} // namespace perf
@@ -0,0 +1,51 @@
+#pragma once
+
+// perf_counters.h
+// Hardware performance counters around benchmark runs: cycles, instructions, branch misses, L1D misses and
+// front end stalls. Linux only (perf_event_open); elsewhere, or when the kernel says no (perf_event_paranoid,
+// containers, virtual machines without a PMU), every counter reads as unavailable and the benchmark goes on.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace perf
+{
+    enum class counter
+    {
+        cycles,
+        instructions,
+        branch_misses,
+        l1d_misses,
+        frontend_stalls,
+        count
+    };
+
+    constexpr size_t counter_count = size_t(counter::count);
+
+    const char* name(counter c);
+
+    struct readings
+    {
+        std::array<uint64_t, counter_count> values{};
+        std::array<bool, counter_count> valid{};
+    };
+
+    /// <summary>
+    /// Opens the counters once, for this thread and every thread it starts afterwards (the thread pool).
+    /// Counters the kernel refuses are simply left out.
+    /// </summary>
+    class counters
+    {
+        std::array<int, counter_count> m_fds;
+    public:
+        counters();
+        ~counters();
+        counters(const counters&) = delete;
+        counters& operator = (const counters&) = delete;
+
+        bool available() const; // at least one counter
+        void start();
+        readings stop();
+    };
+} // namespace perf
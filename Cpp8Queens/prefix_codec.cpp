@@ -0,0 +1,124 @@
+#include <bit>
+
+#include "prefix_codec.h"
+
+namespace prefix
+{
+    namespace
+    {
+        // Before anything is seen, compare against the first row alone: the prefix is then that one column.
+        void reset(uint64_t (&last)[16])
+        {
+            for (int row = 0; row < 16; ++row)
+            {
+                last[row] = uint64_t(row);
+            }
+        }
+
+        inline unsigned row_at(uint64_t solution, int column)
+        {
+            return unsigned(solution >> (4 * column)) & 0xf;
+        }
+
+        // Bits for a rank among free_rows rows: 1 for two rows, 2 for three or four, and so on.
+        inline int rank_width(int free_rows)
+        {
+            return int(std::bit_width(unsigned(free_rows - 1)));
+        }
+    } // anonymous namespace
+
+    encoder::encoder(int board_size, std::vector<uint8_t>& out) : m_board_size(board_size), m_out(out)
+    {
+        reset(m_last);
+    }
+
+    void encoder::add(uint64_t solution)
+    {
+        const unsigned first_row = row_at(solution, 0);
+        const uint64_t difference = solution ^ m_last[first_row];
+        // Column 0 always matches. A repeated solution shares everything.
+        const int shared = difference ? std::countr_zero(difference) / 4 : m_board_size;
+        put(first_row, 4);
+        put(unsigned(shared - 1), 4);
+        unsigned used = 0;
+        for (int column = 0; column < m_board_size - 1; ++column)
+        {
+            const unsigned row = row_at(solution, column);
+            if (column >= shared)
+            {
+                const unsigned rank = unsigned(std::popcount(~used & ((1u << row) - 1)));
+                put(rank, rank_width(m_board_size - column));
+            }
+            used |= 1u << row;
+        }
+        m_last[first_row] = solution;
+    }
+
+    void encoder::finish()
+    {
+        if (m_bit_count)
+        {
+            m_out.push_back(uint8_t(m_bits));
+            m_bits = 0;
+            m_bit_count = 0;
+        }
+    }
+
+    decoder::decoder(const uint8_t* bytes, size_t size, int board_size, uint64_t count) :
+        m_bytes(bytes),
+        m_size(size),
+        m_left(count),
+        m_board_size(board_size)
+    {
+        reset(m_last);
+    }
+
+    bool decoder::next(uint64_t& solution)
+    {
+        unsigned first_row = 0;
+        unsigned shared_minus_one = 0;
+        if (m_left == 0 || !get(4, first_row) || !get(4, shared_minus_one) || int(shared_minus_one) >= m_board_size)
+        {
+            m_left = 0;
+            return false;
+        }
+        const int shared = int(shared_minus_one) + 1;
+        uint64_t result = 0;
+        unsigned used = 0;
+        for (int column = 0; column < m_board_size; ++column)
+        {
+            unsigned row = 0;
+            if (column < shared)
+            {
+                row = row_at(m_last[first_row], column);
+            }
+            else
+            {
+                unsigned rank = 0; // the last column: the only row left
+                if (column < m_board_size - 1 && !get(rank_width(m_board_size - column), rank))
+                {
+                    m_left = 0; // truncated
+                    return false;
+                }
+                // The rank-th row no earlier column uses.
+                unsigned free_rows = ~used & ((1u << m_board_size) - 1);
+                for (; rank && free_rows; --rank)
+                {
+                    free_rows &= free_rows - 1;
+                }
+                if (!free_rows)
+                {
+                    m_left = 0; // corrupt
+                    return false;
+                }
+                row = unsigned(std::countr_zero(free_rows));
+            }
+            result |= uint64_t(row) << (4 * column);
+            used |= 1u << row;
+        }
+        m_last[first_row] = result;
+        --m_left;
+        solution = result;
+        return true;
+    }
+} // namespace prefix
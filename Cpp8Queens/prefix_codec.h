@@ -0,0 +1,87 @@
+#pragma once
+
+// prefix_codec.h
+// Prefix sharing compression of packed solutions (see solution_stream.h). A depth first search finds solutions
+// that differ in the last few columns only, so each one is stored as what it shares with an earlier one, plus the rest.
+//
+// Every solution is a run of bits: the row in column 0 (4 bits), the length of the shared prefix minus one (4 bits),
+// then, for each column after the prefix, the row's rank among the rows no earlier column uses, in as few bits as
+// the number of such rows needs. The last column is left out: a solution is a permutation, one row is left for it.
+//
+// The earlier solution is the last one with the same row in column 0: mirror images and blocks from other threads
+// come interleaved (see async_output.h), but each first row is searched by one thread only.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace prefix
+{
+    class encoder
+    {
+        uint64_t m_last[16];            // last solution seen for each row in column 0
+        const int m_board_size;
+        uint64_t m_bits = 0;            // not yet written, low bits first
+        int m_bit_count = 0;
+        std::vector<uint8_t>& m_out;
+
+        void put(unsigned value, int width)
+        {
+            m_bits |= uint64_t(value) << m_bit_count;
+            m_bit_count += width;
+            while (m_bit_count >= 8)
+            {
+                m_out.push_back(uint8_t(m_bits));
+                m_bits >>= 8;
+                m_bit_count -= 8;
+            }
+        }
+    public:
+        encoder(int board_size, std::vector<uint8_t>& out);
+        void add(uint64_t solution);
+        void add(const uint64_t* solutions, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                add(solutions[i]);
+            }
+        }
+        void finish(); // the last bits, if any, padded to a byte
+    };
+
+    /// <summary>
+    /// Decodes as it goes, from any buffer (a mapped file, typically). The count comes from the file header:
+    /// the last byte may be padded.
+    /// </summary>
+    class decoder
+    {
+        uint64_t m_last[16];
+        const uint8_t* m_bytes;
+        const size_t m_size;
+        size_t m_next_byte = 0;
+        uint64_t m_bits = 0;
+        int m_bit_count = 0;
+        uint64_t m_left;
+        const int m_board_size;
+
+        bool get(int width, unsigned& value)
+        {
+            while (m_bit_count < width)
+            {
+                if (m_next_byte == m_size)
+                {
+                    return false;
+                }
+                m_bits |= uint64_t(m_bytes[m_next_byte++]) << m_bit_count;
+                m_bit_count += 8;
+            }
+            value = unsigned(m_bits & ((1ULL << width) - 1));
+            m_bits >>= width;
+            m_bit_count -= width;
+            return true;
+        }
+    public:
+        decoder(const uint8_t* bytes, size_t size, int board_size, uint64_t count);
+        bool next(uint64_t& solution); // false at the end, or on a truncated or corrupt stream
+    };
+} // namespace prefix
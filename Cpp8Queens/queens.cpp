@@ -12,10 +12,16 @@
 #include <iomanip>
 #include <vector>
 
+#include <immintrin.h>  // _pext_u64, _tzcnt_u32, _blsr_u32: BMI1 and BMI2, only for the _bmi2 entry points.
+
 #include "queens.h"
 #include "high_res_clock.h"
 #include "write_solutions.h"
-#include "utils.h"
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "leaf_kernels.h"
+#include "solution_stream.h"
+#include "microbench.h"
 
 namespace qns
 {
@@ -28,6 +34,9 @@ namespace qns
     static bool verbose = false;
     static int_fast16_t trials = -1;
     static int board_size = 8; // Supported sizes: 4 - 8.
+    static bool fingerprinting = false;
+    static fp::fingerprint solutions_fingerprint;
+    static packed::writer* output = nullptr;
 
     static constexpr int maximum_allowed_board_size = 8; // memory allocations are based on this. 
 
@@ -231,6 +240,33 @@ namespace qns
             return result;
         }
 
+        // Rows not threatened in a column, one bit each. Row r is byte r, the column is bit 7 - column of every byte:
+        // bring that bit down to bit 0, and the multiplication gathers the eight of them in the top byte.
+        inline uint32_t free_rows(const map_t map, int current_column)
+        {
+            const map_t free_bits = (~map >> (7 - current_column)) & 0x0101'0101'0101'0101ULL;
+            return uint32_t((free_bits * 0x0102'0408'1020'4080ULL) >> 56);
+        }
+
+        // Same, in one instruction: pext takes the map bits under the column mask, row 0 first. Needs BMI2.
+        inline uint32_t free_rows_pext(const map_t map, int current_column)
+        {
+            return uint32_t(_pext_u64(~map, column_masks[current_column]));
+        }
+
+        template<bool use_pext>
+        inline uint32_t free_rows_in(const map_t map, int current_column)
+        {
+            if constexpr (use_pext)
+            {
+                return free_rows_pext(map, current_column);
+            }
+            else
+            {
+                return free_rows(map, current_column);
+            }
+        }
+
         // Compile-time calculation since C++ 17. Rules are TIGHT.
         // Google "c++ immediately invoked lambda", aka []{}(); 
         template<typename VALUETYPE, unsigned int BOARD_SIZE>
@@ -304,12 +340,27 @@ namespace qns
     }
 #endif // def _DEBUG
 
+    void record_solution(const std::vector<int>& solution)
+    {
+        // Success! Copy the solution. Don't move, we still need the buffer.
+        std::copy(solution.cbegin(), solution.cend(), solutions[success_count++].begin());
+        if (fingerprinting)
+        {
+            fp::fold(solutions_fingerprint, solution.data(), board_size);
+        }
+        if (output)
+        {
+            output->add_with_mirror(solution.data());
+        }
+    }
+
+    // use_pext: rows from free_rows_pext() and tzcnt, instead of the not_threatened_rows() byte loop and vector.
+    template<bool use_pext>
     void do_solve(map_t map, std::vector<int>& solution, int current_column)
     {
         if (current_column == (board_size - 1))
         {
-            // Success! Copy the solution. Don't move, we still need the buffer.
-            std::copy(solution.cbegin(), solution.cend(), solutions[success_count++].begin());
+            record_solution(solution);
             return;
         }
 #ifdef _DEBUG
@@ -332,6 +383,30 @@ namespace qns
 #endif // def _DEBUG
             return;
         }
+        if (next_column == board_size - 3)
+        {
+            // Every solution is kept here, so no counting shortcut.
+            failures_count += leaf::last_three_columns(threats::free_rows_in<use_pext>(new_map, next_column),
+                threats::free_rows_in<use_pext>(new_map, next_column + 1), threats::free_rows_in<use_pext>(new_map, next_column + 2),
+                [&solution, next_column](int first, int second, int third) {
+                    solution[next_column] = first;
+                    solution[next_column + 1] = second;
+                    solution[next_column + 2] = third;
+                    record_solution(solution);
+                }).dead_ends;
+            solution[next_column] = solution[next_column + 1] = solution[next_column + 2] = -1;
+            return;
+        }
+        if constexpr (use_pext)
+        {
+            for (uint32_t rows_left = threats::free_rows_pext(new_map, next_column); rows_left; rows_left = _blsr_u32(rows_left))
+            {
+                solution[next_column] = int(_tzcnt_u32(rows_left));
+                do_solve<use_pext>(new_map, solution, next_column);
+            }
+            solution[next_column] = -1;
+            return;
+        }
         for (auto current_row : threats::not_threatened_rows(new_map, next_column))
         {
             if (sentinel == current_row)
@@ -347,83 +422,96 @@ namespace qns
             }
 #endif // def _DEBUG
             // Call recursively
-            do_solve(new_map, solution, next_column);
+            do_solve<use_pext>(new_map, solution, next_column);
         }
         // Leave things as they were.
         solution[next_column] = -1;
     } // void do_solve
-} // namespace qns 
-
-#define FOR_PROFILING
-#ifdef FOR_PROFILING
-double qns::solver::solve()
-{
-    // Solution that works for an 8x8 chess board only (not generalized to n by n).
-    // On the other hand, chess boards have 64 squares.
-    // solutions.reserve(46); // Cheating? Nope, just using prior knowledge.
-    std::vector<int> solution(maximum_allowed_board_size, -1);
-#ifdef _DEBUG
-    const int loops = 1;
-#else
-    const int loops = 1000;
-#endif // DEBUG
-
-    const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
-    hi_res_timer::microsecs_t max_time = 0ULL;
-    hi_res_timer::microsecs_t min_time = std::numeric_limits<hi_res_timer::microsecs_t>::max();
-    std::vector<hi_res_timer::microsecs_t> times_vec;
-    times_vec.reserve(loops);
 
-    for (int loop = 0; loop < loops; ++loop)
+    // Timed search with the first queen in rows [first_row, end_row). The solutions buffer holds half a board at most.
+    template<bool use_pext>
+    bench::trial run_rows(int first_row, int end_row)
     {
+        tsc::span setup_span(tsc::phase::setup);
+        // Solution that works for an 8x8 chess board only (not generalized to n by n).
+        // On the other hand, chess boards have 64 squares.
+        // solutions.reserve(46); // Cheating? Nope, just using prior knowledge.
+        std::vector<int> solution(maximum_allowed_board_size, -1);
+
         failures_count = 0;
         success_count = 0;
+        solutions_fingerprint = fp::fingerprint();
         map_t starting_map{ 0ULL };
         for (int i = board_size; i < maximum_allowed_board_size; ++i)
         {
             starting_map |= row_masks[i]; // Threaten all rows outside the board.
         }
+        tsc::span search_span(tsc::phase::search);
         hi_res_timer timer;
-        for (int_fast8_t current_row = 0; current_row < starting_rows_to_test; ++current_row)
+        for (int_fast8_t current_row = first_row; current_row < end_row; ++current_row)
         {
             solution[0] = current_row;
-            do_solve(starting_map, solution, 0);
+            do_solve<use_pext>(starting_map, solution, 0);
         }
         timer.Stop();
-        auto microseconds = timer.GetElapsedMicroseconds();
-        if (microseconds < min_time) min_time = microseconds;
-        if (microseconds > max_time) max_time = microseconds;
-        times_vec.push_back(microseconds);
+        return bench::trial{ timer.GetElapsedMicroseconds(), success_count, failures_count };
     }
+} // namespace qns 
+
+bench::trial qns::solver::run_trial()
+{
+    const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+    return run_rows<false>(0, starting_rows_to_test);
+}
+
+unsigned long long qns::solver::count(int first_row, int end_row)
+{
+    return run_rows<false>(first_row, end_row).success_count;
+}
+
+bench::trial qns::solver::run_trial_bmi2()
+{
+    const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+    return run_rows<true>(0, starting_rows_to_test);
+}
+
+unsigned long long qns::solver::count_bmi2(int first_row, int end_row)
+{
+    return run_rows<true>(first_row, end_row).success_count;
+}
+
+void qns::solver::set_fingerprint(bool on)
+{
+    fingerprinting = on;
+}
 
-    const double median_time = utils::ComputeAndDisplayMedianSpeed(times_vec, min_time, max_time);
-    do_show_results(failures_count, success_count, solutions, board_size);
+fp::fingerprint qns::solver::fingerprint()
+{
+    return qns::solutions_fingerprint;
+}
+
+void qns::solver::set_output(packed::writer* out)
+{
+    qns::output = out;
+}
+
+double qns::solver::solve()
+{
+    tsc::reset_phases();
+    const bench::statistics stats = bench::measure("64 bits", board_size, &run_trial);
+    bench::print(stats);
+    {
+        tsc::span output_span(tsc::phase::output);
+        do_show_results(failures_count, success_count, solutions, board_size);
+    }
+    tsc::print_phases();
     if (success_count < solutions.size())
     {
         solutions[success_count][0] = sentinel;
     }
     std::cout.flush();
-    return median_time;
+    return stats.p50;
 }
-#else
-double qns::solve()
-{
-    // Solution that works for an 8x8 chess board only (not generalized to n by n).
-    // On the other hand, chess boards have 64 squares.
-    // solutions.reserve(46); // Cheating? Nope, just using prior knowledge.
-    std::vector<int> solution(8ULL, -1);
-    hi_res_timer timer;
-    for (int_fast8_t current_row = 0; current_row < 4; ++current_row)
-    {
-        solution[0] = current_row;
-        do_solve(map_t{ 0ULL }, solution, 0);
-    }
-    timer.Stop();
-    std::cout << "Resolving took " << timer.GetElapsedMicroseconds() << " microseconds." << std::endl;
-    do_show_results(failures_count, success_count, solutions, board_size);
-    return double(timer.GetElapsedMicroseconds());
-}
-#endif // FOR_PROFILING
 
 void qns::solver::set_verbose(bool new_val)
 {
@@ -437,6 +525,32 @@ void qns::solver::set_short(int trials$)
     trials = trials$;
 }
 
+void qns::solver::bench_kernels()
+{
+    const int saved_board_size = board_size;
+    board_size = maximum_allowed_board_size;
+    using kernel_state = bench::kernel_state<map_t>;
+    const std::vector<kernel_state> states = bench::random_kernel_states(
+        map_t{ 0ULL }, board_size, 4096,
+        [](map_t map, int row, int column) { return !(map & row_masks[row] & column_masks[column]); },
+        [](map_t map, int row, int column) { return threats::threaten(map, row, column); });
+    const char* engine = "64 bits";
+
+    bench::print_kernel(engine, "(loop overhead)", bench::cycles_per_call(states, [](const kernel_state& s) {
+        return s.map;
+    }));
+    bench::print_kernel(engine, "threats::threaten", bench::cycles_per_call(states, [](const kernel_state& s) {
+        return threats::threaten(s.map, s.row, s.column);
+    }));
+    bench::print_kernel(engine, "threats::is_totally_under_threat", bench::cycles_per_call(states, [](const kernel_state& s) {
+        return threats::is_totally_under_threat(s.map, s.column);
+    }));
+    bench::print_kernel(engine, "threats::not_threatened_rows", bench::cycles_per_call(states, [](const kernel_state& s) {
+        return threats::not_threatened_rows(s.map, s.column)[0];
+    }));
+    board_size = saved_board_size;
+}
+
 void qns::solver::test()
 {
     using std::cout;
@@ -0,0 +1,517 @@
+#define _CRT_SECURE_NO_WARNINGS  // We do NOT support Microsoft's War on Standards.
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "query_service.h"
+#include "high_res_clock.h"
+#include "partial_board.h"
+#include "simd_queens.h"
+#include "solution_tables.h"
+
+namespace service
+{
+    namespace
+    {
+        // Digits only, no sign; false if out of range, however many digits.
+        bool read_int(const std::string& token, long long low, long long high, long long& value)
+        {
+            if (token.empty() || !std::all_of(token.begin(), token.end(), [](char c) { return isdigit((unsigned char)c); }))
+            {
+                return false;
+            }
+            const std::from_chars_result parsed = std::from_chars(token.data(), token.data() + token.size(), value);
+            return parsed.ec == std::errc() && parsed.ptr == token.data() + token.size() && low <= value && value <= high;
+        }
+
+        // Count of every completion of a partial board; the cells are checked by make_query.
+        template<typename backend>
+        uint64_t count_completions(const qnssimd::query& q)
+        {
+            int8_t rows[simd::map_rows];
+            return qnssimd::solver<backend>::complete(q, false, rows);
+        }
+
+        // Counts and solutions of the small boards come from the compile time tables, not from the cache.
+        // Empty if the table does not have the answer.
+        std::string from_table(const std::string& key)
+        {
+            std::istringstream tokens(key);
+            std::string command;
+            int board_size = 0;
+            uint64_t rank = 0;
+            tokens >> command >> board_size >> rank;
+            const qnstable::table* table = qnstable::find(board_size);
+            if (!table || (command != "count" && (command != "solution" || table->count <= rank)))
+            {
+                return std::string();
+            }
+            if (command == "count")
+            {
+                return std::to_string(table->count);
+            }
+            std::string result;
+            for (int column = 0; column < board_size; ++column)
+            {
+                result += (column ? " " : "") + std::to_string(table->solution(rank)[column]);
+            }
+            return result;
+        }
+
+        template<typename backend>
+        uint64_t count_all(int board_size)
+        {
+            qnssimd::instance<backend> solver(board_size);
+            return solver.total();
+        }
+
+#ifndef _WIN32
+        volatile std::sig_atomic_t stop_requested = 0;
+
+        void request_stop(int)
+        {
+            stop_requested = 1;
+        }
+
+        constexpr size_t max_line_length = 64 * 1024; // a client sending more without a new line is dropped
+
+        // The whole reply, however many writes it takes; false if the client is gone.
+        bool send_all(int fd, const std::string& text)
+        {
+            for (size_t sent = 0; sent < text.size(); )
+            {
+                const ssize_t written = write(fd, text.data() + sent, text.size() - sent);
+                if (written < 0 && errno == EINTR)
+                {
+                    continue; // for
+                }
+                if (written <= 0)
+                {
+                    return false;
+                }
+                sent += size_t(written);
+            }
+            return true;
+        }
+#endif // _WIN32
+    } // anonymous namespace
+
+    std::string normalise(const std::string& line, std::string& error, partial::board* board)
+    {
+        std::istringstream tokens(line);
+        std::vector<std::string> words;
+        std::string word;
+        while (tokens >> word)
+        {
+            std::transform(word.begin(), word.end(), word.begin(), [](char c) { return char(tolower((unsigned char)c)); });
+            words.push_back(word);
+        }
+        if (words.empty())
+        {
+            error = "empty request";
+            return std::string();
+        }
+        const std::string& command = words[0];
+        if (command == "stats" || command == "quit")
+        {
+            return command;
+        }
+        if (command != "count" && command != "solution" && command != "complete")
+        {
+            error = "unknown request: " + line;
+            return std::string();
+        }
+        long long board_size = 0;
+        if (words.size() < 2 || !read_int(words[1], 4, 16, board_size))
+        {
+            error = "expected a board size from 4 to 16 after " + command;
+            return std::string();
+        }
+        if (command == "count" && words.size() == 2)
+        {
+            return std::format("count {}", board_size);
+        }
+        if (command == "solution" && words.size() == 3)
+        {
+            long long rank = 0;
+            if (!read_int(words[2], 0, 1'000'000'000'000LL, rank))
+            {
+                error = "expected a solution number";
+                return std::string();
+            }
+            return std::format("solution {} {}", board_size, rank);
+        }
+        if (command == "complete")
+        {
+            // Queens first, then blocked cells, each in (row, column) order.
+            std::vector<std::pair<char, partial::cell>> cells;
+            for (size_t i = 2; i < words.size(); ++i)
+            {
+                char kind = 0;
+                partial::cell cell{ -1, -1 };
+                if (!partial::parse_cell(words[i], kind, cell))
+                {
+                    error = std::format("cannot read {}: expected q<row>,<column> or x<row>,<column>, rows and columns 0 to {}",
+                        words[i], partial::maximum_coordinate);
+                    return std::string();
+                }
+                cells.emplace_back(kind, cell);
+            }
+            auto as_tuple = [](const std::pair<char, partial::cell>& c) { return std::make_tuple(c.first, c.second.row, c.second.column); };
+            std::sort(cells.begin(), cells.end(), [&as_tuple](const auto& a, const auto& b) { return as_tuple(a) < as_tuple(b); });
+            cells.erase(std::unique(cells.begin(), cells.end(), [&as_tuple](const auto& a, const auto& b) { return as_tuple(a) == as_tuple(b); }), cells.end());
+            std::string key = std::format("complete {}", board_size);
+            for (const auto& [kind, cell] : cells)
+            {
+                key += std::format(" {}{},{}", kind, cell.row, cell.column);
+            }
+            if (board != nullptr)
+            {
+                board->board_size = int(board_size);
+                for (const auto& [kind, cell] : cells)
+                {
+                    (kind == 'q' ? board->queens : board->blocked).push_back(cell);
+                }
+            }
+            return key;
+        }
+        error = "wrong number of arguments for " + command;
+        return std::string();
+    }
+
+    int test()
+    {
+        // Request, and what normalise makes of it: empty for an error.
+        const std::pair<const char*, const char*> cases[] = {
+            { "count 8", "count 8" },
+            { "  COUNT\t12 ", "count 12" },
+            { "count 3", "" },
+            { "count 17", "" },
+            { "count 8 1", "" },
+            { "count 9999999999999999999", "" },
+            { "count 99999999999999999999999999", "" },
+            { "solution 8 9999999999999999999", "" },
+            { "solution 8 -1", "" },
+            { "solution 8 91", "solution 8 91" },
+            { "complete 8 x1,2 q0,0 q0,0", "complete 8 q0,0 x1,2" },
+            { "complete 8 z1,2", "" },
+            { "complete 8 q4294967296,0", "" },
+            { "complete 8 q4,0junk", "" },
+            { "complete 8 q1,", "" },
+            { "complete 8 q,1", "" },
+            { "complete 8 q16,0", "" },
+            { "stats", "stats" },
+            { "", "" },
+            { "frobnicate 8", "" },
+        };
+        int failures = 0;
+        for (const auto& [request, expected] : cases)
+        {
+            std::string error;
+            const std::string key = normalise(request, error);
+            const bool pass = (key == expected) && (key.empty() != error.empty());
+            failures += pass ? 0 : 1;
+            std::cout << (pass ? "PASS" : "FAIL") << " normalise(\"" << request << "\"): \"" << key << "\""
+                << (error.empty() ? "" : ", " + error) << std::endl;
+        }
+        return failures;
+    }
+
+    result_cache::result_cache(const std::string& path)
+    {
+        std::ifstream saved(path);
+        std::string line;
+        // Answers from another format, or from engines since fixed, are not answers: start over without them.
+        const bool current = std::getline(saved, line) && line == version_line;
+        while (current && std::getline(saved, line))
+        {
+            const size_t tab = line.find('\t');
+            if (tab != std::string::npos)
+            {
+                m_answers[line.substr(0, tab)] = line.substr(tab + 1);
+            }
+        }
+        saved.close();
+        if (current)
+        {
+            m_file.open(path, std::ios::app);
+        }
+        else
+        {
+            m_file.open(path, std::ios::trunc);
+            m_file << version_line << std::endl;
+        }
+    }
+
+    const std::string* result_cache::find(const std::string& key) const
+    {
+        const auto found = m_answers.find(key);
+        return (found == m_answers.end()) ? nullptr : &found->second;
+    }
+
+    void result_cache::add(const std::string& key, const std::string& answer)
+    {
+        m_answers[key] = answer;
+        if (m_file)
+        {
+            m_file << key << '\t' << answer << std::endl; // flushed: the next process may be started any time
+        }
+    }
+
+    server::server(const std::string& cache_path, bool has_avx2) :
+        m_cache(cache_path),
+        m_has_avx2(has_avx2)
+    {
+    }
+
+    // Same files as -u.
+    const ranking::solution_index& server::index(int board_size)
+    {
+        ranking::solution_index& found = m_indices[board_size];
+        if (found.board_size() != board_size)
+        {
+            const std::string path = "queens_index_" + std::to_string(board_size) + ".bin";
+            if (!found.load(path) || found.board_size() != board_size)
+            {
+                found = ranking::solution_index::build(board_size, ranking::solution_index::default_depth(board_size));
+                found.save(path);
+            }
+        }
+        return found;
+    }
+
+    std::string server::compute(const std::string& key, const partial::board& board, std::string& error)
+    {
+        std::istringstream tokens(key);
+        std::string command;
+        int board_size = 0;
+        tokens >> command >> board_size;
+        if (command == "count")
+        {
+            return std::to_string(m_has_avx2 ? count_all<simd::avx2>(board_size) : count_all<simd::sse2>(board_size));
+        }
+        if (command == "solution")
+        {
+            uint64_t rank = 0;
+            tokens >> rank;
+            const ranking::solution_index& solutions = index(board_size);
+            const std::vector<int> rows = solutions.unrank(rank);
+            if (rows.empty())
+            {
+                error = std::format("no solution #{}: there are {}", rank, solutions.total());
+                return std::string();
+            }
+            std::string result;
+            for (int row : rows)
+            {
+                result += (result.empty() ? "" : " ") + std::to_string(row);
+            }
+            return result;
+        }
+        // complete: normalise has read the cells into board already.
+        qnssimd::query q;
+        if (!qnssimd::make_query(board, q))
+        {
+            error = "not a partial solution";
+            return std::string();
+        }
+        return std::to_string(m_has_avx2 ? count_completions<simd::avx2>(q) : count_completions<simd::sse2>(q));
+    }
+
+    std::string server::answer(const std::string& line, bool& quit)
+    {
+        hi_res_timer timer;
+        std::string error;
+        partial::board board;
+        const std::string key = normalise(line, error, &board);
+        if (key.empty())
+        {
+            return "error " + error;
+        }
+        if (key == "quit")
+        {
+            quit = true;
+            return "bye";
+        }
+        if (key == "stats")
+        {
+            return std::format("{} cached answers, {} hits, {} misses", m_cache.size(), m_hits, m_misses);
+        }
+        if (const std::string table_answer = from_table(key); !table_answer.empty())
+        {
+            ++m_hits;
+            timer.Stop();
+            return std::format("hit {:.1f} {}", timer.GetElapsedMicroseconds(), table_answer);
+        }
+        if (const std::string* cached = m_cache.find(key))
+        {
+            ++m_hits;
+            timer.Stop();
+            return std::format("hit {:.1f} {}", timer.GetElapsedMicroseconds(), *cached);
+        }
+        const std::string computed = compute(key, board, error);
+        if (computed.empty())
+        {
+            return "error " + error;
+        }
+        ++m_misses;
+        m_cache.add(key, computed);
+        timer.Stop();
+        return std::format("miss {:.1f} {}", timer.GetElapsedMicroseconds(), computed);
+    }
+
+    int server::serve(std::istream& in, std::ostream& out)
+    {
+        bool quit = false;
+        std::string line;
+        while (!quit && std::getline(in, line))
+        {
+            out << answer(line, quit) << std::endl;
+        }
+        return 0;
+    }
+
+    int server::serve_socket(const std::string& path)
+    {
+#ifdef _WIN32
+        std::cout << "Unix sockets are not supported here, serving stdin instead of " << path << "." << std::endl;
+        return serve(std::cin, std::cout);
+#else
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::cout << "Socket path too long: " << path << std::endl;
+            return 1;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str()); // left over by an earlier run
+        if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 8) != 0)
+        {
+            std::cout << "Cannot listen on " << path << std::endl;
+            return 1;
+        }
+        // A client gone before its answer must not take the server with it: write() then fails with EPIPE instead.
+        signal(SIGPIPE, SIG_IGN);
+        struct sigaction on_stop {};
+        on_stop.sa_handler = request_stop; // no SA_RESTART: poll() returns with EINTR
+        sigaction(SIGINT, &on_stop, nullptr);
+        sigaction(SIGTERM, &on_stop, nullptr);
+        std::cout << "Listening on " << path << "; quit on stdin, or a signal, to stop." << std::endl;
+
+        struct connection
+        {
+            int fd;
+            std::string pending; // read, not answered yet: lines may arrive split over reads, or several in one
+        };
+        std::vector<connection> clients;
+        std::string stdin_pending;
+        bool stdin_open = true;
+        bool quit = false;
+        stop_requested = 0;
+        while (!quit && !stop_requested)
+        {
+            // Every client at once: an idle one holds up nobody. The requests themselves are answered one at a time.
+            std::vector<pollfd> watched{ { listener, POLLIN, 0 } };
+            if (stdin_open)
+            {
+                watched.push_back({ STDIN_FILENO, POLLIN, 0 });
+            }
+            for (const connection& c : clients)
+            {
+                watched.push_back({ c.fd, POLLIN, 0 });
+            }
+            if (poll(watched.data(), nfds_t(watched.size()), -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue; // while
+                }
+                break; // while
+            }
+            char buffer[4096];
+            size_t next = 1;
+            if (stdin_open)
+            {
+                if (watched[next++].revents)
+                {
+                    const ssize_t received = read(STDIN_FILENO, buffer, sizeof(buffer));
+                    if (received <= 0)
+                    {
+                        stdin_open = false; // detached: only a signal stops the server now
+                    }
+                    else
+                    {
+                        stdin_pending.append(buffer, size_t(received));
+                        for (size_t end_of_line; !quit && (end_of_line = stdin_pending.find('\n')) != std::string::npos; )
+                        {
+                            std::cout << answer(stdin_pending.substr(0, end_of_line), quit) << std::endl;
+                            stdin_pending.erase(0, end_of_line + 1);
+                        }
+                    }
+                }
+            }
+            for (size_t i = 0; i < clients.size(); ++i, ++next)
+            {
+                connection& c = clients[i];
+                if (!watched[next].revents)
+                {
+                    continue; // for
+                }
+                const ssize_t received = read(c.fd, buffer, sizeof(buffer));
+                bool done = received <= 0;
+                if (!done)
+                {
+                    c.pending.append(buffer, size_t(received));
+                    // quit from a client ends its own connection, not the server.
+                    for (size_t end_of_line; !done && (end_of_line = c.pending.find('\n')) != std::string::npos; )
+                    {
+                        done = !send_all(c.fd, answer(c.pending.substr(0, end_of_line), done) + "\n") || done;
+                        c.pending.erase(0, end_of_line + 1);
+                    }
+                    done = done || c.pending.size() > max_line_length;
+                }
+                if (done)
+                {
+                    close(c.fd);
+                    c.fd = -1;
+                }
+            }
+            clients.erase(std::remove_if(clients.begin(), clients.end(), [](const connection& c) { return c.fd < 0; }), clients.end());
+            if (watched[0].revents)
+            {
+                const int accepted = accept(listener, nullptr, nullptr);
+                if (accepted >= 0)
+                {
+                    clients.push_back({ accepted, std::string() });
+                }
+            }
+        }
+        for (const connection& c : clients)
+        {
+            close(c.fd);
+        }
+        close(listener);
+        unlink(path.c_str());
+        std::cout << "Stopped." << std::endl;
+        return 0;
+#endif // _WIN32
+    }
+} // namespace service
@@ -0,0 +1,75 @@
+#pragma once
+
+// query_service.h
+// Long lived solver: one request per line, one answer per line, from stdin or a Unix socket. Answers are cached
+// in memory and in a text file, keyed by the request written the one way (normalise), so asking again, in this
+// process or the next one, costs a hash lookup. Counts and solutions of boards up to 10x10 are not cached: they
+// come from the compile time tables (solution_tables.h), and are answered as hits. Misses go to the engines: the
+// SIMD solver objects for counts and completions, the solution index for the k-th solution.
+//
+// Requests:
+//     count n                 solutions of an n by n board, 4 to 16
+//     solution n k            the k-th one (from 0, lexicographic order)
+//     complete n cells...     completions of a partial board; cells as for -q: q3,0 is a queen, x5,5 a blocked cell
+//     stats                   cache entries, hits and misses
+//     quit                    stop serving (from a socket client: close that connection)
+// Answers: "hit <microseconds> <answer>", "miss <microseconds> <answer>" or "error <message>".
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "partial_board.h"
+#include "solution_index.h"
+
+namespace service
+{
+    // The request written the one way: lower case, single spaces, cells sorted and without repeats.
+    // Empty, with error set, if it is not a request. For complete, the cells also go in board, if given.
+    std::string normalise(const std::string& line, std::string& error, partial::board* board = nullptr);
+
+    // Self test of normalise, for -t: prints a PASS or FAIL line per case, returns the number of failures.
+    int test();
+
+    /// <summary>
+    /// Answers by request, in memory, and appended to a file as they are computed; the file is read back on start.
+    /// One line per answer: the normalised request, a tab, the answer, after a first line with version_line.
+    /// A file without it, or with another, is emptied: change version_line whenever the answers could change.
+    /// </summary>
+    class result_cache
+    {
+        static constexpr const char* version_line = "# queens_cache 1: count by qnssimd, solution by ranking::solution_index, complete by qnssimd";
+        std::unordered_map<std::string, std::string> m_answers;
+        std::ofstream m_file;
+    public:
+        explicit result_cache(const std::string& path);
+
+        const std::string* find(const std::string& key) const; // nullptr on a miss
+        void add(const std::string& key, const std::string& answer);
+        size_t size() const { return m_answers.size(); }
+    };
+
+    class server
+    {
+        result_cache m_cache;
+        const bool m_has_avx2;
+        std::map<int, ranking::solution_index> m_indices; // by board size, loaded or built on first use
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+
+        std::string compute(const std::string& key, const partial::board& board, std::string& error);
+        const ranking::solution_index& index(int board_size);
+    public:
+        server(const std::string& cache_path, bool has_avx2);
+
+        // The answer line for one request line. quit is set by a quit request.
+        std::string answer(const std::string& line, bool& quit);
+
+        int serve(std::istream& in, std::ostream& out); // until quit or the end of in
+        // Until quit on stdin, SIGINT or SIGTERM. Every connected client is listened to; quit from one of them closes
+        // only that connection. Requests are answered one at a time, in the order they arrive.
+        int serve_socket(const std::string& path);
+    };
+}
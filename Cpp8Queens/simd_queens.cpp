@@ -0,0 +1,389 @@
+#define _CRT_SECURE_NO_WARNINGS  // We do NOT support Microsoft's War on Standards.
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "board_map.h"
+#include "simd_queens.h"
+#include "high_res_clock.h"
+#include "write_solutions.h"
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "leaf_kernels.h"
+#include "left_pack.h"
+#include "partial_board.h"
+#include "solution_stream.h"
+
+namespace qnssimd
+{
+    namespace
+    {
+        constexpr int maximum_allowed_board_size = simd::map_rows;
+
+        template<typename backend>
+        struct search
+        {
+            using vector_t = typename backend::vector_t;
+
+            static void record_solution(context& st, const std::vector<int>& solution)
+            {
+                // Success! Copy the solution. Don't move, we still need the buffer.
+                if (st.success_count < st.solutions.size())
+                {
+                    std::copy(solution.cbegin(), solution.cend(), st.solutions[st.success_count].begin());
+                }
+                ++st.success_count;
+                if (st.fingerprinting)
+                {
+                    fp::fold(st.solutions_fingerprint, solution.data(), st.board_size);
+                }
+                if (st.output)
+                {
+                    st.output->add_with_mirror(solution.data());
+                }
+            }
+
+            static void do_solve(context& st, const vector_t map, std::vector<int>& solution, int current_column)
+            {
+                const int next_column = 1 + current_column;
+                if (next_column == st.board_size)
+                {
+                    record_solution(st, solution);
+                    return;
+                }
+
+                const vector_t new_map = backend::or_(map,
+                    backend::load(simd::threats[size_t(solution[current_column] * simd::map_rows + current_column)]));
+                const uint32_t free_rows = backend::free_rows(new_map, backend::load(simd::column_masks[next_column]));
+                if (!free_rows)
+                {
+                    ++st.failures_count;
+                    return;
+                }
+                if (next_column == st.board_size - 3)
+                {
+                    // The last three columns in one go. Just count, once there is nothing left to keep.
+                    const uint32_t second = backend::free_rows(new_map, backend::load(simd::column_masks[next_column + 1]));
+                    const uint32_t third = backend::free_rows(new_map, backend::load(simd::column_masks[next_column + 2]));
+                    if (st.success_count < st.solutions.size() || st.fingerprinting || st.output)
+                    {
+                        st.failures_count += leaf::last_three_columns(free_rows, second, third, [&st, &solution, next_column](int a, int b, int c) {
+                            solution[next_column] = a;
+                            solution[next_column + 1] = b;
+                            solution[next_column + 2] = c;
+                            record_solution(st, solution);
+                        }).dead_ends;
+                        solution[next_column] = solution[next_column + 1] = solution[next_column + 2] = -1;
+                    }
+                    else
+                    {
+                        const leaf::outcome leaves = leaf::last_three_columns(free_rows, second, third, [](int, int, int) {});
+                        st.success_count += leaves.solutions;
+                        st.failures_count += leaves.dead_ends;
+                    }
+                    return;
+                }
+
+                int8_t free_row_numbers[maximum_allowed_board_size];
+                const int free_row_count = lpack::left_pack(free_rows, free_row_numbers);
+                for (int i = 0; i < free_row_count; ++i)
+                {
+                    solution[next_column] = free_row_numbers[i];
+
+                    // Call recursively
+                    do_solve(st, new_map, solution, next_column);
+                }
+                // Leave things as they were.
+                solution[next_column] = -1;
+            } // static void do_solve(context& st, const vector_t map, std::vector<int>& solution, int current_column)
+
+            // Only the columns in open_columns, lowest first: the others have their queens already, folded into the map.
+            static void do_complete(const vector_t map, std::vector<int>& solution, uint32_t open_columns,
+                partial::completions& found, size_t max_solutions)
+            {
+                if (!open_columns)
+                {
+                    if (found.solutions.size() < max_solutions)
+                    {
+                        found.solutions.push_back(solution);
+                    }
+                    ++found.count;
+                    return;
+                }
+                const int column = std::countr_zero(open_columns);
+                const uint32_t free_rows = backend::free_rows(map, backend::load(simd::column_masks[column]));
+                int8_t free_row_numbers[maximum_allowed_board_size];
+                const int free_row_count = lpack::left_pack(free_rows, free_row_numbers);
+                for (int i = 0; i < free_row_count; ++i)
+                {
+                    const int row = free_row_numbers[i];
+                    solution[column] = row;
+                    do_complete(backend::or_(map, backend::load(simd::threats[size_t(row * simd::map_rows + column)])),
+                        solution, open_columns & (open_columns - 1), found, max_solutions);
+                }
+                // Leave things as they were.
+                solution[column] = -1;
+            }
+
+            // Same, counting only, for batches: no vectors. With first_only, the rows of the first completion
+            // are left in rows.
+            static uint64_t do_count_completions(const vector_t map, int8_t* rows, uint32_t open_columns, bool first_only)
+            {
+                if (!open_columns)
+                {
+                    return 1;
+                }
+                const int column = std::countr_zero(open_columns);
+                const uint32_t free_rows = backend::free_rows(map, backend::load(simd::column_masks[column]));
+                int8_t free_row_numbers[maximum_allowed_board_size];
+                const int free_row_count = lpack::left_pack(free_rows, free_row_numbers);
+                uint64_t found = 0;
+                for (int i = 0; i < free_row_count; ++i)
+                {
+                    const int row = free_row_numbers[i];
+                    rows[column] = int8_t(row);
+                    found += do_count_completions(backend::or_(map, backend::load(simd::threats[size_t(row * simd::map_rows + column)])),
+                        rows, open_columns & (open_columns - 1), first_only);
+                    if (first_only && found)
+                    {
+                        return found;
+                    }
+                }
+                return found;
+            }
+
+            // Timed search with the first queen in rows [first_row, end_row).
+            static bench::trial run_rows(context& st, int first_row, int end_row)
+            {
+                tsc::span setup_span(tsc::phase::setup);
+                std::vector<int> solution(st.board_size, -1);
+
+                st.failures_count = 0;
+                st.success_count = 0;
+                st.solutions_fingerprint = fp::fingerprint();
+
+                simd::board_map outside_the_board;
+                for (int i = st.board_size; i < maximum_allowed_board_size; ++i)
+                {
+                    outside_the_board = simd::scalar::or_(outside_the_board, simd::row_mask(i));
+                }
+                const vector_t starting_map = backend::load(outside_the_board);
+                tsc::span search_span(tsc::phase::search);
+                hi_res_timer timer;
+                for (int current_row = first_row; current_row < end_row; ++current_row)
+                {
+                    solution[0] = current_row;
+                    do_solve(st, starting_map, solution, 0);
+                }
+                timer.Stop();
+                return bench::trial{ timer.GetElapsedMicroseconds(), st.success_count, st.failures_count };
+            }
+        };
+    } // anonymous namespace
+
+    template<typename backend>
+    instance<backend>::instance(int board_size)
+    {
+        if (!set_board_size(board_size))
+        {
+            throw std::invalid_argument("Board sizes go from 4 to 16, not " + std::to_string(board_size) + ".");
+        }
+    }
+
+    template<typename backend>
+    bench::trial instance<backend>::run_trial()
+    {
+        const int board_size = m_context.board_size;
+        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+        return search<backend>::run_rows(m_context, 0, starting_rows_to_test);
+    }
+
+    template<typename backend>
+    unsigned long long instance<backend>::count(int first_row, int end_row)
+    {
+        return search<backend>::run_rows(m_context, first_row, end_row).success_count;
+    }
+
+    template<typename backend>
+    unsigned long long instance<backend>::total()
+    {
+        // Same as golden::total, with the fingerprints of both halves summed.
+        const int half = m_context.board_size / 2;
+        unsigned long long result = 2 * count(0, half);
+        fp::fingerprint whole = m_context.solutions_fingerprint;
+        if (m_context.board_size % 2)
+        {
+            result += count(half, half + 1);
+            whole += m_context.solutions_fingerprint;
+        }
+        m_context.solutions_fingerprint = whole;
+        return result;
+    }
+
+    template<typename backend>
+    bool instance<backend>::set_board_size(int size)
+    {
+        if (size < 4 || size > maximum_allowed_board_size)
+        {
+            return false;
+        }
+        m_context.board_size = size;
+        return true;
+    }
+
+    namespace
+    {
+        // The one the static API works on.
+        template<typename backend>
+        instance<backend>& shared_instance()
+        {
+            static instance<backend> shared;
+            return shared;
+        }
+    } // anonymous namespace
+
+    template<typename backend>
+    bench::trial solver<backend>::run_trial()
+    {
+        return shared_instance<backend>().run_trial();
+    }
+
+    template<typename backend>
+    unsigned long long solver<backend>::count(int first_row, int end_row)
+    {
+        return shared_instance<backend>().count(first_row, end_row);
+    }
+
+    template<typename backend>
+    void solver<backend>::set_fingerprint(bool on)
+    {
+        shared_instance<backend>().set_fingerprint(on);
+    }
+
+    template<typename backend>
+    fp::fingerprint solver<backend>::fingerprint()
+    {
+        return shared_instance<backend>().fingerprint();
+    }
+
+    template<typename backend>
+    void solver<backend>::set_output(packed::writer* out)
+    {
+        shared_instance<backend>().set_output(out);
+    }
+
+    template<typename backend>
+    double solver<backend>::solve()
+    {
+        const instance<backend>& shared = shared_instance<backend>();
+        tsc::reset_phases();
+        const bench::statistics stats = bench::measure(std::string("SIMD ") + backend::name, shared.board_size(), &run_trial);
+        bench::print(stats);
+        {
+            tsc::span output_span(tsc::phase::output);
+            do_show_results(shared.dead_ends(), shared.solutions_found(), shared.solutions(), shared.board_size());
+        }
+        tsc::print_phases();
+        std::cout.flush();
+        return stats.p50;
+    }
+
+    template<typename backend>
+    partial::completions solver<backend>::complete(const partial::board& board, size_t max_solutions)
+    {
+        partial::completions found;
+        query q;
+        if (!make_query(board, q))
+        {
+            return found;
+        }
+        found.valid = true;
+        std::vector<int> solution(q.rows, q.rows + board.board_size);
+        search<backend>::do_complete(backend::load(q.start), solution, q.open_columns, found, max_solutions);
+        return found;
+    }
+
+    template<typename backend>
+    uint64_t solver<backend>::complete(const query& q, bool first_only, int8_t* rows)
+    {
+        std::copy(q.rows, q.rows + simd::map_rows, rows);
+        return search<backend>::do_count_completions(backend::load(q.start), rows, q.open_columns, first_only);
+    }
+
+    bool make_query(const partial::board& board, query& out)
+    {
+        const int board_size = board.board_size;
+        if (board_size < 4 || board_size > maximum_allowed_board_size)
+        {
+            return false;
+        }
+        auto on_board = [board_size](const partial::cell& c) {
+            return 0 <= c.row && c.row < board_size && 0 <= c.column && c.column < board_size;
+        };
+
+        out.start = simd::board_map();
+        for (int i = board_size; i < maximum_allowed_board_size; ++i)
+        {
+            out.start = simd::scalar::or_(out.start, simd::row_mask(i));
+        }
+        std::fill(std::begin(out.rows), std::end(out.rows), int8_t(-1));
+        // Each queen checked against the ones before her: attacks go both ways.
+        for (const partial::cell& queen : board.queens)
+        {
+            if (!on_board(queen) || out.rows[queen.column] != -1 || simd::is_set(out.start, queen.row, queen.column))
+            {
+                return false;
+            }
+            out.rows[queen.column] = int8_t(queen.row);
+            out.start = simd::scalar::or_(out.start, simd::threats[size_t(queen.row * simd::map_rows + queen.column)]);
+        }
+        for (const partial::cell& cell : board.blocked)
+        {
+            if (!on_board(cell) || out.rows[cell.column] == cell.row)
+            {
+                return false;
+            }
+            simd::set_cell(out.start, cell.row, cell.column);
+        }
+        out.open_columns = 0;
+        for (int column = 0; column < board_size; ++column)
+        {
+            if (out.rows[column] == -1)
+            {
+                out.open_columns |= 1u << column;
+            }
+        }
+        return true;
+    }
+
+    template<typename backend>
+    void solver<backend>::set_verbose(bool new_val)
+    {
+        std::cout << "Setting verbose to " << new_val << std::endl;
+        shared_instance<backend>().set_verbose(new_val);
+    }
+
+    template<typename backend>
+    void solver<backend>::set_board_size(int size)
+    {
+        if (!shared_instance<backend>().set_board_size(size))
+        {
+            std::cout << "Size must be between 4 and " << maximum_allowed_board_size << ", it is " << size << ". Doing nothing.";
+        }
+    }
+
+    template class instance<simd::scalar>;
+    template class instance<simd::sse2>;
+    template class instance<simd::avx2>;
+    template class instance<simd::avx512>;
+
+    template struct solver<simd::scalar>;
+    template struct solver<simd::sse2>;
+    template struct solver<simd::avx2>;
+    template struct solver<simd::avx512>;
+} // namespace qnssimd
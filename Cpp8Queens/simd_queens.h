@@ -0,0 +1,122 @@
+#pragma once
+
+// simd_queens.h
+// Solution for 16x16, written once against board_map.h and instantiated for each instruction set:
+// qnssimd::solver<simd::scalar>, <simd::sse2>, <simd::avx2> and <simd::avx512>.
+// The search keeps everything it reads and writes in a context, so that solver objects (qnssimd::instance) can run
+// side by side, on different threads; the static solver API the benchmark uses is one shared instance per backend.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "board_map.h"
+#include "fingerprint.h"
+
+namespace bench
+{
+    struct trial; // forward declaration
+}
+
+namespace packed
+{
+    class writer; // forward declaration
+}
+
+namespace partial
+{
+    struct board; // see partial_board.h
+    struct completions;
+}
+
+namespace qnssimd
+{
+    // A completion query, ready to search: the fixed queens' threats and the blocked cells are in the map already.
+    // Built once, searched as often as needed, with no allocation.
+    struct query
+    {
+        simd::board_map start;
+        uint32_t open_columns = 0; // bit c: column c has no queen yet
+        int8_t rows[simd::map_rows]; // the fixed queens' rows; -1 in the open columns, and off the board
+    };
+
+    // False if board is not a partial solution (see partial::completions::valid), or bigger than 16x16.
+    bool make_query(const partial::board& board, query& out);
+
+    // Settings, counters and the first solutions of one search.
+    struct context
+    {
+        static constexpr size_t solutions_kept = 50; // as many as the other 16x16 engines show
+
+        int board_size = simd::map_rows; // Supported sizes: 4 - 16
+        bool verbose = false;
+        bool fingerprinting = false;
+        packed::writer* output = nullptr;
+        uint64_t failures_count = 0;
+        uint64_t success_count = 0;
+        fp::fingerprint solutions_fingerprint;
+        std::vector<std::vector<int>> solutions =
+            std::vector<std::vector<int>>(solutions_kept, std::vector<int>(simd::map_rows, -1));
+    };
+
+    /// <summary>
+    /// Solver object: its own board size, settings, counters and solutions. Different instances share nothing, and
+    /// can search at the same time on different threads; one instance runs one search at a time.
+    ///     qnssimd::instance<simd::avx2> solver(12);
+    ///     const auto all = solver.total(); // 14'200
+    /// </summary>
+    template<typename backend>
+    class instance
+    {
+        context m_context;
+    public:
+        explicit instance(int board_size = simd::map_rows); // throws std::invalid_argument outside 4 to 16
+
+        bench::trial run_trial(); // one timed search of half the board
+        unsigned long long count(int first_row, int end_row); // solutions with the first queen in rows [first_row, end_row)
+        unsigned long long total(); // the whole board, mirror images included; fingerprint() then covers it all
+        bool set_board_size(int size); // false, and no change, outside 4 to 16
+
+        void set_fingerprint(bool on) { m_context.fingerprinting = on; }
+        void set_output(packed::writer* out) { m_context.output = out; } // nullptr for none; one writer per instance
+        void set_verbose(bool new_val) { m_context.verbose = new_val; }
+
+        int board_size() const { return m_context.board_size; }
+        fp::fingerprint fingerprint() const { return m_context.solutions_fingerprint; }
+        unsigned long long solutions_found() const { return m_context.success_count; } // by the last search
+        unsigned long long dead_ends() const { return m_context.failures_count; }
+        // The first solutions_kept found by the last search, rows by column; only solutions_found() of them are filled.
+        const std::vector<std::vector<int>>& solutions() const { return m_context.solutions; }
+    };
+
+    // Static API over one shared instance per backend, for the benchmark harness.
+    template<typename backend>
+    struct solver
+    {
+        static double solve(); // returns median microseconds
+        static bench::trial run_trial(); // one timed solve, no output
+        static unsigned long long count(int first_row, int end_row); // solutions with the first queen in rows [first_row, end_row)
+        static void set_fingerprint(bool on); // fold every solution found into fingerprint()
+        static fp::fingerprint fingerprint(); // of the last search, when enabled
+        static void set_output(packed::writer* out); // every solution found goes there too, nullptr for none
+        static void set_verbose(bool new_val);
+        static void set_board_size(int size);
+
+        // Every way of filling the columns board leaves open, keeping the first max_solutions of them. Boards up to
+        // 16x16; independent of set_board_size, the counters, fingerprints and output.
+        static partial::completions complete(const partial::board& board, size_t max_solutions);
+        // Completions of q; with first_only, stops at the first one. rows (16 entries) is scratch space for the search:
+        // with first_only and a count of 1, it holds that completion; otherwise, only whatever path was tried last.
+        static uint64_t complete(const query& q, bool first_only, int8_t* rows);
+    };
+
+    // Instantiated in simd_queens.cpp, for these only.
+    extern template class instance<simd::scalar>;
+    extern template class instance<simd::sse2>;
+    extern template class instance<simd::avx2>;
+    extern template class instance<simd::avx512>;
+    extern template struct solver<simd::scalar>;
+    extern template struct solver<simd::sse2>;
+    extern template struct solver<simd::avx2>;
+    extern template struct solver<simd::avx512>;
+}
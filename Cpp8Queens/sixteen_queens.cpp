@@ -24,7 +24,11 @@ typedef union  __declspec(intrin_type) __declspec(align(32)) __m256i {
 #include "sixteen_queens.h"
 #include "high_res_clock.h"
 #include "write_solutions.h"
-#include "utils.h"
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "leaf_kernels.h"
+#include "solution_stream.h"
+#include "microbench.h"
 
 using namespace qns16cmn;
 
@@ -75,6 +79,9 @@ namespace qns16
 	static uint_fast32_t success_count = 0;
 	static bool verbose = false;
 	static int board_size = maximum_allowed_board_size; // Supported sizes: 4 - 16
+	static bool fingerprinting = false;
+	static fp::fingerprint solutions_fingerprint;
+	static packed::writer* output = nullptr;
 
 	inline bool is_totally_under_threat(const map_t& map, int current_column)
 	{
@@ -110,20 +117,46 @@ namespace qns16
 		return map | threats[(size_t)(row * maximum_allowed_board_size + col)];
 	}
 
+	// Rows not threatened in a column, one bit each. Row r is m256i_u16[r], the column is bit 15 - column of each:
+	// bring that bit down to bit 0, and a multiplication gathers four rows at a time from each 64 bit lane.
+	inline uint32_t free_rows(const map_t& map, int current_column)
+	{
+		uint32_t result = 0;
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			const uint64_t free_bits = (~map.m256i_u64[lane] >> (15 - current_column)) & 0x0001'0001'0001'0001ULL;
+			result |= uint32_t(((free_bits * 0x0001'0002'0004'0008ULL) >> 48) & 0xf) << (4 * lane);
+		}
+		return result;
+	}
+
+	void record_solution(const std::vector<int>& solution)
+	{
+		// Success! Copy the solution. Don't move, we still need the buffer.
+		if (success_count < solutions.size())
+		{
+			// TODO: USE AVX2 OR MEMCPY TO COPY THE DATA. 
+			// INVARIANT: The destination has 16 integers, and the source has board_size.
+			std::copy(solution.cbegin(), solution.cend(), solutions[success_count].begin());
+		}
+		++success_count;
+		if (fingerprinting)
+		{
+			fp::fold(solutions_fingerprint, solution.data(), board_size);
+		}
+		if (output)
+		{
+			output->add_with_mirror(solution.data());
+		}
+	}
+
 	// map by value, because it't not const. 
 	void do_solve(const map_t& map, std::vector<int>& solution, int current_column)
 	{
 		const int next_column = 1 + current_column;
 		if (next_column == board_size)
 		{
-			// Success! Copy the solution. Don't move, we still need the buffer.
-			if (success_count < solutions.size())
-			{
-				// TODO: USE AVX2 OR MEMCPY TO COPY THE DATA. 
-				// INVARIANT: The destination has 16 integers, and the source has board_size.
-				std::copy(solution.cbegin(), solution.cend(), solutions[success_count].begin());
-			}
-			++success_count;
+			record_solution(solution);
 			return;
 		}
 		const map_t new_map = threaten(map, solution[current_column], current_column);
@@ -132,6 +165,30 @@ namespace qns16
 			++failures_count;
 			return;
 		}
+		if (next_column == board_size - 3)
+		{
+			// The last three columns in one go. Just count, once there is nothing left to keep.
+			const uint32_t first = free_rows(new_map, next_column);
+			const uint32_t second = free_rows(new_map, next_column + 1);
+			const uint32_t third = free_rows(new_map, next_column + 2);
+			if (success_count < solutions.size() || fingerprinting || output)
+			{
+				failures_count += leaf::last_three_columns(first, second, third, [&solution, next_column](int a, int b, int c) {
+					solution[next_column] = a;
+					solution[next_column + 1] = b;
+					solution[next_column + 2] = c;
+					record_solution(solution);
+				}).dead_ends;
+				solution[next_column] = solution[next_column + 1] = solution[next_column + 2] = -1;
+			}
+			else
+			{
+				const leaf::outcome leaves = leaf::last_three_columns(first, second, third, [](int, int, int) {});
+				success_count += leaves.solutions;
+				failures_count += leaves.dead_ends;
+			}
+			return;
+		}
 
 		for (auto current_row : not_threatened_rows(new_map& column_masks[next_column], board_size, next_column))
 		{
@@ -148,47 +205,71 @@ namespace qns16
 		solution[next_column] = -1;
 	} // void do_solve(map_t map, std::vector<int>& solution, int current_column)
 
-	double solver::solve()
+	// Timed search with the first queen in rows [first_row, end_row).
+	bench::trial run_rows(int first_row, int end_row)
 	{
-		failures_count = 0ULL;
-		success_count = 0ULL;
+		tsc::span setup_span(tsc::phase::setup);
 		std::vector<int> solution(board_size, -1);
-		const int loops = int(pow(16 - board_size, 3)) + 1;
 
-		const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
-		hi_res_timer::microsecs_t max_time = 0ULL;
-		hi_res_timer::microsecs_t min_time = std::numeric_limits<hi_res_timer::microsecs_t>::max();
-		std::vector<hi_res_timer::microsecs_t> times_vec;
-		times_vec.reserve(loops);
+		failures_count = 0;
+		success_count = 0;
+		solutions_fingerprint = fp::fingerprint();
 
-		for (int loop = 0; loop < loops; ++loop)
+		map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } };
+		for (int i = board_size; i < maximum_allowed_board_size; ++i)
 		{
-			failures_count = 0;
-			success_count = 0;
-
-			map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } };
-			for (int i = board_size; i < maximum_allowed_board_size; ++i)
-			{
-				starting_map = starting_map | row_masks[i];
-			}
-			hi_res_timer timer;
-			for (int_fast8_t current_row = 0; current_row < starting_rows_to_test; ++current_row)
-			{
-				solution[0] = current_row;
-				do_solve(starting_map, solution, 0);
-			}
-			timer.Stop();
-			auto microseconds = timer.GetElapsedMicroseconds();
-			if (microseconds < min_time) min_time = microseconds;
-			if (microseconds > max_time) max_time = microseconds;
-			times_vec.push_back(microseconds);
+			starting_map = starting_map | row_masks[i];
 		}
+		tsc::span search_span(tsc::phase::search);
+		hi_res_timer timer;
+		for (int_fast8_t current_row = first_row; current_row < end_row; ++current_row)
+		{
+			solution[0] = current_row;
+			do_solve(starting_map, solution, 0);
+		}
+		timer.Stop();
+		return bench::trial{ timer.GetElapsedMicroseconds(), success_count, failures_count };
+	}
 
-		const double median_time = utils::ComputeAndDisplayMedianSpeed(times_vec, min_time, max_time);
-		do_show_results(failures_count, success_count, solutions, board_size);
+	bench::trial solver::run_trial()
+	{
+		const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+		return run_rows(0, starting_rows_to_test);
+	}
+
+	unsigned long long solver::count(int first_row, int end_row)
+	{
+		return run_rows(first_row, end_row).success_count;
+	}
+
+	void solver::set_fingerprint(bool on)
+	{
+		fingerprinting = on;
+	}
+
+	fp::fingerprint solver::fingerprint()
+	{
+		return solutions_fingerprint;
+	}
+
+	void solver::set_output(packed::writer* out)
+	{
+		output = out;
+	}
+
+	double solver::solve()
+	{
+		tsc::reset_phases();
+		const bench::statistics stats = bench::measure("256 bits", board_size, &run_trial);
+		bench::print(stats);
+		{
+			tsc::span output_span(tsc::phase::output);
+			do_show_results(failures_count, success_count, solutions, board_size);
+		}
+		tsc::print_phases();
 		std::cout.flush();
 
-		return double(median_time);
+		return stats.p50;
 	}
 
 	void solve_once()
@@ -218,6 +299,31 @@ namespace qns16
 		std::cout.flush();
 	}
 
+	void solver::bench_kernels()
+	{
+		using kernel_state = bench::kernel_state<map_t>;
+		const std::vector<kernel_state> states = bench::random_kernel_states(
+			map_t{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } }, int(maximum_allowed_board_size), 4096,
+			[](const map_t& map, int row, int column) { return !(map.m256i_u16[row] & column_masks[column].m256i_u16[row]); },
+			[](const map_t& map, int row, int column) { return threaten(map, row, column); });
+		const char* engine = "256 bits";
+		const int size = int(maximum_allowed_board_size);
+		std::vector<int> result(maximum_allowed_board_size + 1, sentinel);
+
+		bench::print_kernel(engine, "(loop overhead)", bench::cycles_per_call(states, [](const kernel_state& s) {
+			return s.map.m256i_u64[0];
+		}));
+		bench::print_kernel(engine, "qns16::threaten", bench::cycles_per_call(states, [](const kernel_state& s) {
+			return threaten(s.map, s.row, s.column).m256i_u64[0];
+		}));
+		bench::print_kernel(engine, "qns16::is_totally_under_threat", bench::cycles_per_call(states, [](const kernel_state& s) {
+			return is_totally_under_threat(s.map, s.column);
+		}));
+		bench::print_kernel(engine, "qns16cmn::not_threatened_rows_mt", bench::cycles_per_call(states, [&](const kernel_state& s) {
+			return not_threatened_rows_mt(s.map & column_masks[s.column], size, s.column, result)[0];
+		}));
+	}
+
 	void solver::set_verbose(bool new_val)
 	{
 		std::cout << "Setting verbose to " << new_val << std::endl;
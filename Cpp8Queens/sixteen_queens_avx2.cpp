@@ -9,11 +9,13 @@
 
 #include <immintrin.h>  // Using intel intrinsics to learn about it. Precondition: you need AVX2 at least (which you probably have).
 
+#include "board_map.h"
 #include "sixteen_queens_common.h"
 #include "sixteen_queens_avx2.h"
-#include "high_res_clock.h"
-#include "write_solutions.h"
-#include "utils.h"
+#include "benchmark.h"
+#include "left_pack.h"
+#include "microbench.h"
+#include "simd_queens.h"
 
 using namespace qns16cmn;
 
@@ -26,33 +28,11 @@ namespace qns16avx2
     // Should also look at the examples in https://www.codeproject.com/Articles/874396/Crunching-Numbers-with-AVX-and-AVX
     // And the movie: https://www.youtube.com/watch?v=AT5nuQQO96o 
 
-    // Bitwise equality. 
-    __forceinline bool operator == (const m256i a, const m256i b)
-    {
-        return (0xffff'ffff == _mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)));
-    }
-
-    // Bitwise and.
-    __forceinline m256i operator & (const m256i a, const m256i b)
-    {
-        return _mm256_and_si256(a, b);
-    }
-
-    // Bitwise or.
-    __forceinline m256i operator | (const m256i a, const m256i b)
-    {
-        return _mm256_or_si256(a, b);
-    }
+    using namespace simd::m256i_operators; // ==, & and |
 
-    // Note: 
-    // =====
-    // From https://en.wikipedia.org/wiki/Eight_queens_puzzle#Counting_solutions_for_other_sizes_n
-    // There are 14,772,512 solutions for n = 16, should get half of that. We'll just count them (expected 7'386'256), not build them.
-
-    static uint_fast32_t failures_count = 0;
-    static uint_fast32_t success_count = 0;
-    static bool verbose = false;
-    static int board_size = maximum_allowed_board_size; // Supported sizes: 4 - 16
+    // The search itself is qnssimd::solver<simd::avx2> (simd_queens.cpp): the same threats map, the same movemask
+    // squeeze, written once for every instruction set. What is left here are the kernels it grew out of, for -m.
+    using search = qnssimd::solver<simd::avx2>;
 
     inline bool is_totally_under_threat(const map_t map, int current_column)
     {
@@ -61,18 +41,15 @@ namespace qns16avx2
     }
 
 
-// #define MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
-#ifdef MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
     // Performance wise, this give us nothing for 16x16, and we lose for smaller board sizes.
     // But the code is shorter, and we learn a neat AVX2 trick. 
-    // _p is for packed.
+    // _p is for packed. The search never used it by default; bench_kernels() keeps an eye on it.
     static const ALIGN_8Q m256i indices { .m256i_i16{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 , 11, 12, 13, 14, 15 } };
     m256i not_threatened_rows_p(const map_t& map, int current_column)
     {
         auto cm = column_masks[current_column];
         return _mm256_or_si256(indices, _mm256_cmpeq_epi16(_mm256_and_si256(map, cm), cm)); // Sentinel where threatened.
     }
-#endif // MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
 
     // Intel Intrinsics are not constexpr. Bummer.
     #define make_threat(row, column) (row_masks[row] | main_diagonal_parallels[row + 15 - column] | second_diagonal_parallels[row + column] )
@@ -110,145 +87,116 @@ namespace qns16avx2
     }; 
     static const Threats threats;
 
-    // map by value, because it't not const. 
-    void do_solve(const map_t map, std::vector<int>& solution, int current_column)
+    // Rows not threatened in a column, one bit each. A row is free when its word ANDed with the column mask is zero:
+    // movemask gives two bits per row, keep the even ones and squeeze them together.
+    inline uint32_t free_rows(const map_t map, int current_column)
     {
-        const int next_column = 1 + current_column;
-        if (next_column == board_size) _UNLIKELY
-        {
-            // Success! Copy the solution. Don't move, we still need the buffer.
-            if (success_count < solutions.size()) _LIKELY
-            {
-                // TODO: USE AVX2 OR MEMCPY TO COPY THE DATA. 
-                // INVARIANT: The destination has 16 integers, and the source has board_size.
-                std::copy(solution.cbegin(), solution.cend(), solutions[success_count].begin());
-            }
-            ++success_count;
-#ifdef _DEBUG
-            if ((success_count & 0xff) == 0x7ff)
-            {
-                std::cout 
-                    << "    (So far " << std::dec << success_count << " solutions and " 
-                    << failures_count << " failures.)" << std::endl;
-                std::cout.flush();
-            }
-#endif // _DEBUG
-            return;
-        }
-
-        const map_t new_map = threats.Threaten(map, solution[current_column], current_column);
-        if (is_totally_under_threat(new_map, next_column)) _UNLIKELY
-        {
-            ++failures_count;
-            return;
-        }
+        const m256i is_free = _mm256_cmpeq_epi16(_mm256_and_si256(map, column_masks[current_column]), _mm256_setzero_si256());
+        uint32_t bits = uint32_t(_mm256_movemask_epi8(is_free)) & 0x5555'5555;
+        bits = (bits | (bits >> 1)) & 0x3333'3333;
+        bits = (bits | (bits >> 2)) & 0x0f0f'0f0f;
+        bits = (bits | (bits >> 4)) & 0x00ff'00ff;
+        return (bits | (bits >> 8)) & 0xffff;
+    }
 
-#ifdef MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
-        m256i not_threatened = not_threatened_rows_p(new_map, next_column);
-        for (auto current_row : not_threatened.m256i_i16)
-        {
-            if (sentinel == current_row)
-            {
-                continue;
-            }
-            solution[next_column] = current_row;
+    bench::trial solver::run_trial()
+    {
+        return search::run_trial();
+    }
 
-            // Call recursively
-            do_solve(new_map, solution, next_column);
-        }
-#else
-        for (auto current_row : not_threatened_rows(new_map& column_masks[next_column], board_size, next_column))
-        {
-            if (sentinel == current_row) _UNLIKELY
-            {
-                break;
-            }
-            solution[next_column] = current_row;
+    unsigned long long solver::count(int first_row, int end_row)
+    {
+        return search::count(first_row, end_row);
+    }
 
-            // Call recursively
-            do_solve(new_map, solution, next_column);
-        }
+    void solver::set_fingerprint(bool on)
+    {
+        search::set_fingerprint(on);
+    }
 
-#endif // MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
+    fp::fingerprint solver::fingerprint()
+    {
+        return search::fingerprint();
+    }
 
-        // Leave things as they were.
-        solution[next_column] = -1;
-    } // void do_solve(map_t map, std::vector<int>& solution, int current_column)
+    void solver::set_output(packed::writer* out)
+    {
+        search::set_output(out);
+    }
 
     double solver::solve()
     {
-        failures_count = 0ULL;
-        success_count = 0ULL;
-        std::vector<int> solution(board_size, -1);
-        const int loops = int(pow(16 - board_size, 3)) + 1;
-
-
-        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
-        hi_res_timer::microsecs_t max_time = 0ULL;
-        hi_res_timer::microsecs_t min_time = std::numeric_limits<hi_res_timer::microsecs_t>::max();
-        std::vector<hi_res_timer::microsecs_t> times_vec;
-        times_vec.reserve(loops);
-
-        for (int loop = 0; loop < loops; ++loop)
-        {
-            failures_count = 0;
-            success_count = 0;
+        return search::solve();
+    }
 
-            map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } };
-            for (int i = board_size; i < maximum_allowed_board_size; ++i)
+    void solver::bench_kernels()
+    {
+        using kernel_state = bench::kernel_state<map_t>;
+        const std::vector<kernel_state> states = bench::random_kernel_states(
+            map_t{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } }, int(maximum_allowed_board_size), 4096,
+            [](const map_t& map, int row, int column) { return !(map.m256i_u16[row] & column_masks[column].m256i_u16[row]); },
+            [](const map_t& map, int row, int column) { return threats.Threaten(map, row, column); });
+        const char* engine = "AVX2";
+        const int size = int(maximum_allowed_board_size);
+        std::vector<int> result(maximum_allowed_board_size + 1, sentinel);
+
+        bench::print_kernel(engine, "(loop overhead)", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return s.map.m256i_u64[0];
+        }));
+        bench::print_kernel(engine, "Threats::Threaten", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return threats.Threaten(s.map, s.row, s.column).m256i_u64[0];
+        }));
+        bench::print_kernel(engine, "is_totally_under_threat", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return is_totally_under_threat(s.map, s.column);
+        }));
+        bench::print_kernel(engine, "qns16cmn::not_threatened_rows_mt", bench::cycles_per_call(states, [&](const kernel_state& s) {
+            return not_threatened_rows_mt(s.map & column_masks[s.column], size, s.column, result)[0];
+        }));
+        bench::print_kernel(engine, "not_threatened_rows_p (packed)", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return not_threatened_rows_p(s.map, s.column).m256i_u64[0];
+        }));
+
+        // What do_solve really pays: produce the rows, then walk them.
+        bench::print_kernel(engine, "not_threatened_rows_mt + walk", bench::cycles_per_call(states, [&](const kernel_state& s) {
+            int sum = 0;
+            for (auto row : not_threatened_rows_mt(s.map & column_masks[s.column], size, s.column, result))
             {
-                starting_map = starting_map | row_masks[i];
+                if (sentinel == row)
+                {
+                    break;
+                }
+                sum += row;
             }
-            hi_res_timer timer;
-            for (int_fast8_t current_row = 0; current_row < starting_rows_to_test; ++current_row)
+            return sum;
+        }));
+        bench::print_kernel(engine, "free_rows + left_pack + walk", bench::cycles_per_call(states, [](const kernel_state& s) {
+            int8_t rows[maximum_allowed_board_size];
+            const int count = lpack::left_pack(free_rows(s.map, s.column), rows);
+            int sum = 0;
+            for (int i = 0; i < count; ++i)
             {
-                solution[0] = current_row;
-                do_solve(starting_map, solution, 0);
+                sum += rows[i];
             }
-            timer.Stop();
-            auto microseconds = timer.GetElapsedMicroseconds();
-            if (microseconds < min_time) _UNLIKELY min_time = microseconds;
-            if (microseconds > max_time) _UNLIKELY max_time = microseconds;
-            times_vec.push_back(microseconds);
-        }
-
-        const double median_time = utils::ComputeAndDisplayMedianSpeed(times_vec, min_time, max_time);
-        do_show_results(failures_count, success_count, solutions, board_size);
-        std::cout.flush();
-        return double(median_time);
-    }
-
-    void solve_once()
-    {
-        failures_count = 0;
-        success_count = 0;
-        std::vector<int> solution(board_size, -1);
-        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
-        map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } };
-        for (int i = board_size; i < maximum_allowed_board_size; ++i)
-        {
-            starting_map = starting_map | row_masks[i];
-        }
-        hi_res_timer timer;
-        for (int_fast8_t current_row = 0; current_row < starting_rows_to_test; ++current_row)
-        {
-            solution[0] = current_row;
-            do_solve(starting_map, solution, 0);
-        }
-        timer.Stop();
-        std::cout << "Resolving took " << timer.GetElapsedMicroseconds() 
-            << " microseconds, with " << success_count << " solutions and " 
-            << failures_count << " failures for half a board of size " << board_size  
-            << "." << std::endl;
-        std::cout.flush();
-        do_show_results(failures_count, success_count, solutions, board_size);
-        std::cout.flush();
+            return sum;
+        }));
+        bench::print_kernel(engine, "not_threatened_rows_p + walk", bench::cycles_per_call(states, [](const kernel_state& s) {
+            int sum = 0;
+            m256i not_threatened = not_threatened_rows_p(s.map, s.column);
+            for (auto row : not_threatened.m256i_i16)
+            {
+                if (sentinel == row)
+                {
+                    continue;
+                }
+                sum += row;
+            }
+            return sum;
+        }));
     }
 
     void solver::set_verbose(bool new_val)
     {
-        std::cout << "Setting verbose to " << new_val << std::endl;
-        verbose = new_val;
+        search::set_verbose(new_val);
     }
 
     void solver::test()
@@ -261,7 +209,7 @@ namespace qns16avx2
         map_t threatened = threats.Threaten(starting_map, 2, 0);
         std::vector<int> solution(16, -1);
         solution[0] = 2;
-        dbg::show_map(threatened, solution, board_size);
+        dbg::show_map(threatened, solution, int(maximum_allowed_board_size));
     #endif // def _DEBUG
 
         set_board_size(4);
@@ -283,17 +231,7 @@ namespace qns16avx2
 
     void solver::set_board_size(int size)
     {
-        if (size < 4)
-        {
-            std::cout << "Size must be at least 4, it is " << size << ". Doing nothing.";
-            return;
-        }
-        if (size > 16)
-        {
-            std::cout << "Size must be at most 16, it is " << size << ". Doing nothing.";
-            return;
-        }
-        board_size = size;
+        search::set_board_size(size);
     }
 
 } // namespace qns16avx2
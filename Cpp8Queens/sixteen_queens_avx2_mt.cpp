@@ -5,17 +5,25 @@
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 // #include <thread>
 #include <vector>
 
 #include <immintrin.h>  // Using intel intrinsics to learn about it. Precondition: you need AVX2 at least (which you probably have).
 
+#include "board_map.h"
 #include "sixteen_queens_common.h"
 #include "sixteen_queens_avx2_mt.h"
 #include "high_res_clock.h"
 #include "write_solutions.h"
 #include "thread_pool.h"
-#include "utils.h"
+#include "benchmark.h"
+#include "fingerprint.h"
+#include "leaf_kernels.h"
+#include "left_pack.h"
+#include "solution_stream.h"
+#include "async_output.h"
+#include "microbench.h"
 
 
 using namespace qns16cmn;
@@ -30,23 +38,7 @@ namespace qns16avx2mt
     // And the movie: https://www.youtube.com/watch?v=AT5nuQQO96o 
     // Note: don't take __m256i by referance, always by value. Most of the time it's a register, dereference and you lose.
 
-    // Bitwise equality. 
-    __forceinline bool operator == (const m256i a, const m256i b)
-    {
-        return (0xffff'ffff == _mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b)));
-    }
-
-    // Bitwise and.
-    __forceinline m256i operator & (const m256i a, const m256i b)
-    {
-        return _mm256_and_si256(a, b);
-    }
-
-    // Bitwise or.
-    __forceinline m256i operator | (const m256i a, const m256i b)
-    {
-        return _mm256_or_si256(a, b);
-    }
+    using namespace simd::m256i_operators; // ==, & and |
 
     // Note: 
     // =====
@@ -56,11 +48,16 @@ namespace qns16avx2mt
     uint_fast32_t success_count = 0; // total for all threads
     bool verbose = false;
     int board_size = maximum_allowed_board_size; // Supported sizes: 4 - 16
+    bool fingerprinting = false;
+    fp::fingerprint solutions_fingerprint; // sum of the threads' own
+    packed::writer* output = nullptr;
 
     struct thread_data
     {
         uint_fast32_t failures_count = 0;
         uint_fast32_t success_count = 0;
+        fp::fingerprint solutions_fingerprint; // no sharing, no locks: summed after the threads are done
+        async_out::producer* out = nullptr; // this thread's own, when writing solutions out
         // We save first 12 per thread.
         std::vector<std::vector<int>> solutions{
             std::vector<int>(16, sentinel),
@@ -154,20 +151,50 @@ namespace qns16avx2mt
     }; 
     static const Threats threats;
 
+    // Rows not threatened in a column, one bit each. A row is free when its word ANDed with the column mask is zero:
+    // movemask gives two bits per row, keep the even ones and squeeze them together.
+    inline uint32_t free_rows(const map_t map, int current_column)
+    {
+        const m256i is_free = _mm256_cmpeq_epi16(_mm256_and_si256(map, column_masks[current_column]), _mm256_setzero_si256());
+        uint32_t bits = uint32_t(_mm256_movemask_epi8(is_free)) & 0x5555'5555;
+        bits = (bits | (bits >> 1)) & 0x3333'3333;
+        bits = (bits | (bits >> 2)) & 0x0f0f'0f0f;
+        bits = (bits | (bits >> 4)) & 0x00ff'00ff;
+        return (bits | (bits >> 8)) & 0xffff;
+    }
+
+    void record_solution(const std::vector<int>& solution, thread_data& td)
+    {
+        // Success! Copy the solution. Don't move, we still need the buffer.
+        if (td.success_count < td.solutions.size())
+        {
+            // TODO: USE AVX2 OR MEMCPY TO COPY THE DATA. 
+            // INVARIANT: The destination has 16 integers, and the source has board_size.
+            std::copy(solution.cbegin(), solution.cend(), td.solutions[td.success_count].begin());
+        }
+        ++td.success_count;
+        if (fingerprinting)
+        {
+            fp::fold(td.solutions_fingerprint, solution.data(), board_size);
+        }
+        if (td.out)
+        {
+            const uint64_t packed_solution = packed::pack(solution.data(), board_size);
+            td.out->add(packed_solution);
+            if (packed::has_distinct_mirror(packed_solution, board_size))
+            {
+                td.out->add(packed::mirror(packed_solution, board_size));
+            }
+        }
+    }
+
     // map by value, because it't not const. 
     void do_solve(const map_t map, std::vector<int>& solution, int current_column, thread_data &td)
     {
         const int next_column = 1 + current_column;
         if (next_column == board_size)
         {
-            // Success! Copy the solution. Don't move, we still need the buffer.
-            if (td.success_count < td.solutions.size())
-            {
-                // TODO: USE AVX2 OR MEMCPY TO COPY THE DATA. 
-                // INVARIANT: The destination has 16 integers, and the source has board_size.
-                std::copy(solution.cbegin(), solution.cend(), td.solutions[td.success_count].begin());
-            }
-            ++td.success_count;
+            record_solution(solution, td);
             return;
         }
 
@@ -177,6 +204,30 @@ namespace qns16avx2mt
             ++td.failures_count;
             return;
         }
+        if (next_column == board_size - 3)
+        {
+            // The last three columns in one go. Just count, once there is nothing left to keep.
+            const uint32_t first = free_rows(new_map, next_column);
+            const uint32_t second = free_rows(new_map, next_column + 1);
+            const uint32_t third = free_rows(new_map, next_column + 2);
+            if (td.success_count < td.solutions.size() || fingerprinting || td.out)
+            {
+                td.failures_count += leaf::last_three_columns(first, second, third, [&solution, &td, next_column](int a, int b, int c) {
+                    solution[next_column] = a;
+                    solution[next_column + 1] = b;
+                    solution[next_column + 2] = c;
+                    record_solution(solution, td);
+                }).dead_ends;
+                solution[next_column] = solution[next_column + 1] = solution[next_column + 2] = -1;
+            }
+            else
+            {
+                const leaf::outcome leaves = leaf::last_three_columns(first, second, third, [](int, int, int) {});
+                td.success_count += leaves.solutions;
+                td.failures_count += leaves.dead_ends;
+            }
+            return;
+        }
 
 #ifdef MY_COMPUTER_SUPPORTS_AVX2_AND_I_HAVE_TIME
         m256i not_threatened = not_threatened_rows_p(new_map, next_column);
@@ -192,13 +243,12 @@ namespace qns16avx2mt
             do_solve(new_map, solution, next_column, td);
         }
 #else
-        for (auto current_row : not_threatened_rows_mt(new_map & column_masks[next_column], board_size, next_column, td.safe_indices[next_column]))
+        // Compare, movemask, left-pack: no branch per row, unlike the conditional stores of not_threatened_rows_mt().
+        int8_t free_row_numbers[maximum_allowed_board_size];
+        const int free_row_count = lpack::left_pack(free_rows(new_map, next_column), free_row_numbers);
+        for (int i = 0; i < free_row_count; ++i)
         {
-            if (sentinel == current_row)
-            {
-                break;
-            }
-            solution[next_column] = current_row;
+            solution[next_column] = free_row_numbers[i];
 
             // Call recursively
             do_solve(new_map, solution, next_column, td);
@@ -236,20 +286,11 @@ namespace qns16avx2mt
         int get_success_count() const { return m_data.success_count; }
     };
 
-    double solver::solve()
+    // Timed search with the first queen in rows [first_row, end_row), split among the threads.
+    bench::trial run_rows(int first_row, int end_row)
     {
-        failures_count = 0ULL;
-        success_count = 0ULL;
-        std::vector<int> solution(board_size, -1);
-        const int loops = int(pow(16 - board_size, 3)) + 1;
-
-
-        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
-        hi_res_timer::microsecs_t max_time = 0ULL;
-        hi_res_timer::microsecs_t min_time = std::numeric_limits<hi_res_timer::microsecs_t>::max();
-        std::vector<hi_res_timer::microsecs_t> times_vec;
-        times_vec.reserve(loops);
-
+        tsc::span setup_span(tsc::phase::setup);
+        const int starting_rows_to_test = end_row - first_row;
 
         int n_threads = (int)std::thread::hardware_concurrency(); // Could encapsulate this in thread pool.
         // std::cout << n_threads << " concurrent threads are supported." << std::endl;
@@ -261,8 +302,8 @@ namespace qns16avx2mt
         ldiv_t thr_manager = ldiv(starting_rows_to_test, n_threads);
         // e.g., 14x14 with 2 cores: quot = 3, rem = 2.
         // So threads should be: 0-3, 4-7, 8-10, 11-13 (three per thread and the first 2 get an additional one)
-        std::vector<int> starting_indexes(size_t(n_threads) + 1, starting_rows_to_test); // for the last one. 
-        int j = 0;
+        std::vector<int> starting_indexes(size_t(n_threads) + 1, end_row); // for the last one. 
+        int j = first_row;
         for (int i_thread = 0; i_thread < n_threads; ++i_thread)
         {
             starting_indexes[i_thread] = j;
@@ -274,54 +315,125 @@ namespace qns16avx2mt
             }
         }
 
-        for (int loop = 0; loop < loops; ++loop)
-        {
-            failures_count = 0;
-            success_count = 0;
+        failures_count = 0;
+        success_count = 0;
+        solutions_fingerprint = fp::fingerprint();
 
-            map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL }  };
-            for (int i = board_size; i < maximum_allowed_board_size; ++i)
-            {
-                starting_map = starting_map | row_masks[i];
-            }
+        map_t starting_map{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL }  };
+        for (int i = board_size; i < maximum_allowed_board_size; ++i)
+        {
+            starting_map = starting_map | row_masks[i];
+        }
 
-            std::vector<thread_data> all_data(n_threads, thread_data());
-            std::vector<QueensSlice> slices;
+        std::vector<thread_data> all_data(n_threads, thread_data());
+        // Writing happens on a thread of its own, while we search. Blocks arrive in no particular order.
+        std::unique_ptr<async_out::pipeline> pipe;
+        if (output)
+        {
+            pipe = std::make_unique<async_out::pipeline>(
+                [](const uint64_t* solutions, size_t count) { output->append(solutions, count); }, n_threads);
             for (int i_thread = 0; i_thread < n_threads; ++i_thread)
             {
-                slices.push_back(
-                    QueensSlice(
-                        starting_indexes[i_thread],
-                        starting_indexes[size_t(i_thread) + 1],
-                        all_data[i_thread],
-                        starting_map))
-                    ;
+                all_data[i_thread].out = &pipe->get_producer(i_thread);
             }
+        }
+        std::vector<QueensSlice> slices;
+        for (int i_thread = 0; i_thread < n_threads; ++i_thread)
+        {
+            slices.push_back(
+                QueensSlice(
+                    starting_indexes[i_thread],
+                    starting_indexes[size_t(i_thread) + 1],
+                    all_data[i_thread],
+                    starting_map))
+                ;
+        }
 
-            ThreadPool<QueensSlice> pool;
-            hi_res_timer timer;
-            for (int i_thread = 0; i_thread < n_threads; ++i_thread)
-            {
-                pool.push(&slices[i_thread]);
-            }
-            pool.wait_all();
+        ThreadPool<QueensSlice> pool;
+        tsc::span search_span(tsc::phase::search);
+        hi_res_timer timer;
+        for (int i_thread = 0; i_thread < n_threads; ++i_thread)
+        {
+            pool.push(&slices[i_thread]);
+        }
+        pool.wait_all();
+        {
+            tsc::span merge_span(tsc::phase::merge);
             for (int i_thread = 0; i_thread < n_threads; ++i_thread)
             {
                 failures_count += all_data[i_thread].failures_count;
                 success_count += all_data[i_thread].success_count;
+                solutions_fingerprint += all_data[i_thread].solutions_fingerprint;
+            }
+            if (pipe)
+            {
+                pipe->finish();
             }
-            timer.Stop();
-
-            auto microseconds = timer.GetElapsedMicroseconds();
-            if (microseconds < min_time) min_time = microseconds;
-            if (microseconds > max_time) max_time = microseconds;
-            times_vec.push_back(microseconds);
         }
+        timer.Stop();
+        return bench::trial{ timer.GetElapsedMicroseconds(), success_count, failures_count };
+    }
 
-        const double median_time = utils::ComputeAndDisplayMedianSpeed(times_vec, min_time, max_time);
+    bench::trial solver::run_trial()
+    {
+        const int starting_rows_to_test = (board_size / 2) + (board_size % 2);
+        return run_rows(0, starting_rows_to_test);
+    }
+
+    unsigned long long solver::count(int first_row, int end_row)
+    {
+        return run_rows(first_row, end_row).success_count;
+    }
+
+    void solver::set_fingerprint(bool on)
+    {
+        fingerprinting = on;
+    }
+
+    fp::fingerprint solver::fingerprint()
+    {
+        return solutions_fingerprint;
+    }
+
+    void solver::set_output(packed::writer* out)
+    {
+        output = out;
+    }
+
+    double solver::solve()
+    {
+        tsc::reset_phases();
+        const bench::statistics stats = bench::measure("AVX2 multithreaded", board_size, &run_trial);
+        bench::print(stats);
+        tsc::print_phases();
         // TODO: Merge solutions and call this. do_show_results(failures_count, success_count, solutions, board_size);
         std::cout.flush();
-        return double(median_time);
+        return stats.p50;
+    }
+
+    void solver::bench_kernels()
+    {
+        using kernel_state = bench::kernel_state<map_t>;
+        const std::vector<kernel_state> states = bench::random_kernel_states(
+            map_t{ .m256i_u64 { 0ULL, 0ULL, 0ULL, 0ULL } }, int(maximum_allowed_board_size), 4096,
+            [](const map_t& map, int row, int column) { return !(map.m256i_u16[row] & column_masks[column].m256i_u16[row]); },
+            [](const map_t& map, int row, int column) { return threats.Threaten(map, row, column); });
+        const char* engine = "AVX2 multithreaded";
+        const int size = int(maximum_allowed_board_size);
+        thread_data td;
+
+        bench::print_kernel(engine, "(loop overhead)", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return s.map.m256i_u64[0];
+        }));
+        bench::print_kernel(engine, "Threats::Threaten", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return threats.Threaten(s.map, s.row, s.column).m256i_u64[0];
+        }));
+        bench::print_kernel(engine, "is_totally_under_threat", bench::cycles_per_call(states, [](const kernel_state& s) {
+            return is_totally_under_threat(s.map, s.column);
+        }));
+        bench::print_kernel(engine, "qns16cmn::not_threatened_rows_mt", bench::cycles_per_call(states, [&](const kernel_state& s) {
+            return not_threatened_rows_mt(s.map & column_masks[s.column], size, s.column, td.safe_indices[s.column])[0];
+        }));
     }
 
     void solver::set_verbose(bool new_val)
@@ -3,14 +3,35 @@
 // sixteen_queens_avx2_mt.h
 // Solution for 16x16, using AVX2 to improve performance (by about 40%)
 
+namespace bench
+{
+    struct trial; // forward declaration
+}
+
+namespace fp
+{
+    struct fingerprint; // forward declaration
+}
+
+namespace packed
+{
+    class writer; // forward declaration
+}
+
 namespace qns16avx2mt
 {
     // namespace cannot be a template argument
     struct solver
     {
         static double solve(); // returns median microseconds
+        static bench::trial run_trial(); // one timed solve, no output
+        static unsigned long long count(int first_row, int end_row); // solutions with the first queen in rows [first_row, end_row)
+        static void set_fingerprint(bool on); // fold every solution found into fingerprint()
+        static fp::fingerprint fingerprint(); // of the last search, when enabled
+        static void set_output(packed::writer* out); // every solution found goes there too, nullptr for none
         static void set_verbose(bool new_val);
         static void test();
+        static void bench_kernels(); // microbenchmarks of the primitives
         static void set_board_size(int size);
     };
 }
\ No newline at end of file
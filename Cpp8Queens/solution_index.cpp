@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "bit_count.h"
+#include "solution_index.h"
+
+namespace ranking
+{
+    namespace
+    {
+        const char index_magic[8] = { 'Q', 'N', 'S', 'I', 'N', 'D', 'E', 'X' };
+
+        // Row in column `column` of a prefix key.
+        int row_of(uint64_t key, int depth, int column)
+        {
+            return int((key >> (4 * (depth - 1 - column))) & 0xf);
+        }
+
+        // Mirror image of a prefix: row r becomes row n - 1 - r. Same number of solutions below it.
+        uint64_t mirror_key(uint64_t key, int depth, int board_size)
+        {
+            uint64_t result = 0;
+            for (int i = 0; i < depth; ++i)
+            {
+                const uint64_t row = (key >> (4 * i)) & 0xf;
+                result |= uint64_t(board_size - 1 - row) << (4 * i);
+            }
+            return result;
+        }
+    } // anonymous namespace
+
+    int solution_index::default_depth(int board_size)
+    {
+        if (board_size <= 6)
+        {
+            return 2;
+        }
+        if (board_size <= 9)
+        {
+            return 3;
+        }
+        if (board_size <= 12)
+        {
+            return 4;
+        }
+        return 5;
+    }
+
+    solution_index solution_index::build(int board_size, int depth)
+    {
+        solution_index index;
+        if (board_size < 1 || board_size > 16)
+        {
+            return index;
+        }
+        depth = std::clamp(depth, 1, std::min(board_size, max_depth));
+        index.m_board_size = board_size;
+        index.m_depth = depth;
+
+        const uint32_t all = bits::all_rows(board_size);
+        // Prefixes starting in the lower half are counted; the upper half are their mirror images, counted already.
+        std::unordered_map<uint64_t, uint64_t> lower_half;
+        struct frame
+        {
+            bits::state s;
+            uint64_t key;
+            int column;
+        };
+        // Depth first, rows in increasing order: prefixes come out sorted.
+        auto visit = [&](auto&& self, const frame& f) -> void {
+            if (f.column == depth)
+            {
+                const int first_row = row_of(f.key, depth, 0);
+                uint64_t count = 0;
+                if (2 * first_row < board_size)
+                {
+                    count = bits::count(f.s, all);
+                    lower_half[f.key] = count;
+                }
+                else
+                {
+                    count = lower_half[mirror_key(f.key, depth, board_size)];
+                }
+                if (count)
+                {
+                    index.m_prefixes.push_back(f.key);
+                    index.m_first_rank.push_back(index.m_total);
+                    index.m_total += count;
+                }
+                return;
+            }
+            for (uint32_t candidates = bits::free_rows(f.s, all); candidates; candidates &= candidates - 1)
+            {
+                const uint32_t row_bit = candidates & (0u - candidates);
+                const uint64_t row = uint64_t(std::countr_zero(row_bit));
+                self(self, frame{ bits::place(f.s, row_bit), (f.key << 4) | row, f.column + 1 });
+            }
+        };
+        visit(visit, frame{ bits::state(), 0, 0 });
+        return index;
+    }
+
+    bool solution_index::save(const std::string& path) const
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        const int32_t sizes[2] = { m_board_size, m_depth };
+        const uint64_t counts[2] = { m_total, uint64_t(m_prefixes.size()) };
+        out.write(index_magic, sizeof(index_magic));
+        out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+        out.write(reinterpret_cast<const char*>(m_prefixes.data()), std::streamsize(m_prefixes.size() * sizeof(uint64_t)));
+        out.write(reinterpret_cast<const char*>(m_first_rank.data()), std::streamsize(m_first_rank.size() * sizeof(uint64_t)));
+        return bool(out);
+    }
+
+    bool solution_index::load(const std::string& path)
+    {
+        *this = solution_index();
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(index_magic)] = {};
+        int32_t sizes[2] = {};
+        uint64_t counts[2] = {};
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+        in.read(reinterpret_cast<char*>(counts), sizeof(counts));
+        if (!in || memcmp(magic, index_magic, sizeof(magic)) != 0
+            || sizes[0] < 1 || sizes[0] > 16 || sizes[1] < 1 || sizes[1] > std::min(sizes[0], max_depth))
+        {
+            return false;
+        }
+        // The rest of the file is the two arrays, nothing more: check before allocating them.
+        const std::streamoff header_end = in.tellg();
+        in.seekg(0, std::ios::end);
+        const std::streamoff file_end = in.tellg();
+        in.seekg(header_end);
+        if (!in || counts[1] == 0 || counts[1] > uint64_t(file_end - header_end) / (2 * sizeof(uint64_t))
+            || counts[1] * 2 * sizeof(uint64_t) != uint64_t(file_end - header_end))
+        {
+            return false;
+        }
+        std::vector<uint64_t> prefixes(static_cast<size_t>(counts[1]));
+        std::vector<uint64_t> first_rank(static_cast<size_t>(counts[1]));
+        in.read(reinterpret_cast<char*>(prefixes.data()), std::streamsize(prefixes.size() * sizeof(uint64_t)));
+        in.read(reinterpret_cast<char*>(first_rank.data()), std::streamsize(first_rank.size() * sizeof(uint64_t)));
+        if (!in || first_rank[0] != 0)
+        {
+            return false;
+        }
+        // As build() makes them: prefixes ascending, rows on the board, every prefix with at least one solution.
+        for (size_t i = 0; i < prefixes.size(); ++i)
+        {
+            for (int column = 0; column < sizes[1]; ++column)
+            {
+                if (row_of(prefixes[i], sizes[1], column) >= sizes[0])
+                {
+                    return false;
+                }
+            }
+            const uint64_t next_rank = (i + 1 < prefixes.size()) ? first_rank[i + 1] : counts[0];
+            if ((i > 0 && prefixes[i] <= prefixes[i - 1]) || (prefixes[i] >> (4 * sizes[1])) != 0 || next_rank <= first_rank[i])
+            {
+                return false;
+            }
+        }
+        // The total is the last prefix's first rank plus the solutions below it: one subtree to count.
+        std::vector<int> rows(size_t(sizes[0]), -1);
+        for (int column = 0; column < sizes[1]; ++column)
+        {
+            rows[column] = row_of(prefixes.back(), sizes[1], column);
+        }
+        bits::state s;
+        if (!bits::place_all(rows.data(), sizes[1], s) || first_rank.back() + bits::count(s, bits::all_rows(sizes[0])) != counts[0])
+        {
+            return false;
+        }
+        m_board_size = sizes[0];
+        m_depth = sizes[1];
+        m_total = counts[0];
+        m_prefixes = std::move(prefixes);
+        m_first_rank = std::move(first_rank);
+        return true;
+    }
+
+    std::vector<int> solution_index::unrank(uint64_t rank) const
+    {
+        if (rank >= m_total)
+        {
+            return {};
+        }
+        const size_t i = size_t(std::upper_bound(m_first_rank.begin(), m_first_rank.end(), rank) - m_first_rank.begin()) - 1;
+        std::vector<int> rows(m_board_size, -1);
+        for (int column = 0; column < m_depth; ++column)
+        {
+            rows[column] = row_of(m_prefixes[i], m_depth, column);
+        }
+        bits::state s;
+        bits::place_all(rows.data(), m_depth, s);
+
+        // Down the subtree: skip whole children while the rank is past them.
+        const uint32_t all = bits::all_rows(m_board_size);
+        uint64_t left = rank - m_first_rank[i];
+        for (int column = m_depth; column < m_board_size; ++column)
+        {
+            for (uint32_t candidates = bits::free_rows(s, all); candidates; candidates &= candidates - 1)
+            {
+                const uint32_t row_bit = candidates & (0u - candidates);
+                const bits::state child = bits::place(s, row_bit);
+                const uint64_t below = bits::count(child, all);
+                if (left < below)
+                {
+                    rows[column] = std::countr_zero(row_bit);
+                    s = child;
+                    break; // for
+                }
+                left -= below;
+            }
+        }
+        return rows;
+    }
+
+    uint64_t solution_index::rank(const std::vector<int>& rows) const
+    {
+        const uint64_t not_found = ~0ULL;
+        if (m_total == 0 || int(rows.size()) != m_board_size)
+        {
+            return not_found;
+        }
+        for (int row : rows)
+        {
+            if (row < 0 || row >= m_board_size)
+            {
+                return not_found;
+            }
+        }
+        bits::state s;
+        if (!bits::place_all(rows.data(), m_board_size, s))
+        {
+            return not_found;
+        }
+
+        uint64_t key = 0;
+        for (int column = 0; column < m_depth; ++column)
+        {
+            key = (key << 4) | uint64_t(rows[column]);
+        }
+        const auto it = std::lower_bound(m_prefixes.begin(), m_prefixes.end(), key);
+        if (it == m_prefixes.end() || *it != key)
+        {
+            return not_found;
+        }
+        uint64_t result = m_first_rank[size_t(it - m_prefixes.begin())];
+
+        // Everything in the subtree that comes before: smaller rows, column by column.
+        s = bits::state();
+        bits::place_all(rows.data(), m_depth, s);
+        const uint32_t all = bits::all_rows(m_board_size);
+        for (int column = m_depth; column < m_board_size; ++column)
+        {
+            const uint32_t smaller = (1u << rows[column]) - 1;
+            for (uint32_t candidates = bits::free_rows(s, all) & smaller; candidates; candidates &= candidates - 1)
+            {
+                result += bits::count(bits::place(s, candidates & (0u - candidates)), all);
+            }
+            s = bits::place(s, 1u << rows[column]);
+        }
+        return result;
+    }
+} // namespace ranking
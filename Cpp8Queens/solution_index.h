@@ -0,0 +1,40 @@
+#pragma once
+
+// solution_index.h
+// Random access to the solutions of one board size, in lexicographic order (row in column 0 first, then column 1...).
+// The index holds, for every prefix of the first depth columns that has any solution below it, how many solutions
+// come before it. unrank() finds the prefix by binary search, then walks down its subtree using counts;
+// rank() does the opposite. Building the index counts every solution once; after that, save it and load it.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ranking
+{
+    class solution_index
+    {
+        int m_board_size = 0;
+        int m_depth = 0;
+        uint64_t m_total = 0;
+        std::vector<uint64_t> m_prefixes;       // sorted: column 0 in the highest nibble of the depth used
+        std::vector<uint64_t> m_first_rank;     // solutions before each prefix
+    public:
+        static constexpr int max_depth = 15;      // 4 bits a column in a uint64_t key, and shifts by 4 * depth must stay under 64
+        static int default_depth(int board_size); // a few hundred solutions per prefix at most, for 16x16
+        static solution_index build(int board_size, int depth);
+
+        bool save(const std::string& path) const;
+        bool load(const std::string& path); // false if missing or malformed; the index is then left empty
+
+        int board_size() const { return m_board_size; }
+        int depth() const { return m_depth; }
+        uint64_t total() const { return m_total; }
+        size_t prefixes() const { return m_prefixes.size(); }
+
+        // rank from 0 to total() - 1. Row of the queen in each column.
+        std::vector<int> unrank(uint64_t rank) const;
+        // ~0ULL if rows is not a solution for this board size.
+        uint64_t rank(const std::vector<int>& rows) const;
+    };
+} // namespace ranking
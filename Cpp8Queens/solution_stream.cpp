@@ -0,0 +1,263 @@
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include "solution_stream.h"
+
+namespace packed
+{
+    namespace
+    {
+        constexpr size_t buffer_solutions = 64 * 1024; // half a megabyte per write
+        constexpr size_t buffer_rows = 128 * 1024; // same for rows
+
+        header make_header(int board_size, uint64_t count, encoding coding)
+        {
+            header h{};
+            memcpy(h.magic, magic, sizeof(h.magic));
+            h.version = version;
+            h.board_size = uint32_t(board_size);
+            h.count = count;
+            h.coding = coding;
+            return h;
+        }
+    } // anonymous namespace
+
+    writer::writer(const std::string& path, int board_size, encoding coding) :
+        m_board_size(board_size),
+        m_coding(coding)
+    {
+        if (board_size < 1 || board_size > 16)
+        {
+            throw std::runtime_error("Packed solutions support boards up to 16x16.");
+        }
+        m_file.open(path, std::ios::binary | std::ios::trunc); // only now: a bad size leaves an existing file alone
+        if (!m_file)
+        {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        m_buffer.reserve(buffer_solutions);
+        if (coding == encoding::shared_prefix)
+        {
+            m_encoder = std::make_unique<prefix::encoder>(board_size, m_encoded);
+        }
+        // Count unknown yet: rewritten by close().
+        const header h = make_header(board_size, 0, coding);
+        m_file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+
+    writer::~writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception& e) // callers who want to know call close() themselves
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void writer::write(const uint64_t* solutions, size_t count)
+    {
+        if (m_encoder)
+        {
+            m_encoded.clear();
+            m_encoder->add(solutions, count);
+            m_file.write(reinterpret_cast<const char*>(m_encoded.data()), std::streamsize(m_encoded.size()));
+        }
+        else
+        {
+            m_file.write(reinterpret_cast<const char*>(solutions), std::streamsize(count * sizeof(uint64_t)));
+        }
+        m_count += count;
+    }
+
+    void writer::flush()
+    {
+        if (!m_buffer.empty())
+        {
+            write(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+    }
+
+    void writer::append(const uint64_t* solutions, size_t count)
+    {
+        flush(); // keep the order
+        write(solutions, count);
+    }
+
+    void writer::close()
+    {
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        flush();
+        if (m_encoder)
+        {
+            m_encoded.clear();
+            m_encoder->finish();
+            m_file.write(reinterpret_cast<const char*>(m_encoded.data()), std::streamsize(m_encoded.size()));
+        }
+        const header h = make_header(m_board_size, m_count, m_coding);
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        m_file.close();
+        if (!m_file)
+        {
+            throw std::runtime_error("Could not write every solution: disk full, or the file went away.");
+        }
+    }
+
+    row_writer::row_writer(const std::string& path, uint32_t board_size) :
+        m_file(path, std::ios::binary | std::ios::trunc),
+        m_board_size(board_size)
+    {
+        if (board_size < 1)
+        {
+            throw std::runtime_error("No board to write.");
+        }
+        if (!m_file)
+        {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        m_buffer.reserve(buffer_rows);
+        const header h = make_header(int(board_size), 0, encoding::wide_rows);
+        m_file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+
+    row_writer::~row_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void row_writer::flush()
+    {
+        if (!m_buffer.empty())
+        {
+            m_file.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(m_buffer.size() * sizeof(uint32_t)));
+            m_rows += m_buffer.size();
+            m_buffer.clear();
+        }
+    }
+
+    void row_writer::close()
+    {
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        flush();
+        const header h = make_header(int(m_board_size), count(), encoding::wide_rows);
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        m_file.close();
+        if (!m_file)
+        {
+            throw std::runtime_error("Could not write every row: disk full, or the file went away.");
+        }
+    }
+
+    mapped_solutions::mapped_solutions(const std::string& path)
+    {
+        const void* view = nullptr;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        m_bytes = size_t(file_size.QuadPart);
+        HANDLE mapping = (m_bytes >= sizeof(header)) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        if (mapping)
+        {
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+        m_file = file;
+        m_mapping = mapping;
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        m_bytes = size_t(st.st_size);
+        if (m_bytes >= sizeof(header))
+        {
+            void* mapped = mmap(nullptr, m_bytes, PROT_READ, MAP_SHARED, fd, 0);
+            view = (mapped == MAP_FAILED) ? nullptr : mapped;
+        }
+        close(fd); // the mapping keeps the file
+#endif // _WIN32
+        m_header = static_cast<const header*>(view);
+        // Every solution takes 8 bytes plain, at least one byte (two nibbles) encoded, and 4 bytes a row wide.
+        const bool valid = m_header
+            && memcmp(m_header->magic, magic, sizeof(magic)) == 0
+            && m_header->version == version
+            && ((m_header->board_size <= 16 && m_header->coding == encoding::plain && m_header->count <= (m_bytes - sizeof(header)) / sizeof(uint64_t))
+                || (m_header->board_size <= 16 && m_header->coding == encoding::shared_prefix && m_header->count <= m_bytes - sizeof(header))
+                || (m_header->coding == encoding::wide_rows && m_header->board_size > 0
+                    && m_header->count <= (m_bytes - sizeof(header)) / sizeof(uint32_t) / m_header->board_size));
+        if (!valid)
+        {
+            release(); // the constructor did not finish, so the destructor will not run
+            throw std::runtime_error("Not a packed solutions file: " + path);
+        }
+        m_solutions = reinterpret_cast<const uint64_t*>(m_header + 1);
+        m_payload = reinterpret_cast<const uint8_t*>(m_header + 1);
+    }
+
+    mapped_solutions::~mapped_solutions()
+    {
+        release();
+    }
+
+    void mapped_solutions::release()
+    {
+#ifdef _WIN32
+        if (m_header)
+        {
+            UnmapViewOfFile(m_header);
+        }
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+        if (m_file)
+        {
+            CloseHandle(m_file);
+        }
+#else
+        if (m_header)
+        {
+            munmap(const_cast<header*>(m_header), m_bytes);
+        }
+#endif // _WIN32
+        m_header = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+    }
+} // namespace packed
@@ -0,0 +1,217 @@
+#pragma once
+
+// solution_stream.h
+// Compact binary file of solutions: a 32 byte header, then one 64-bit word per solution, the row of the queen
+// in column c in bits 4c to 4c + 3. Boards up to 16x16. The words are little endian, like every machine we run on.
+// Or, several times smaller, a prefix sharing stream of nibbles (see prefix_codec.h).
+// Boards above 16x16 do not fit in a word: their files hold rows, one 32-bit word per column, solution after solution.
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "prefix_codec.h"
+
+namespace packed
+{
+    enum class encoding : uint32_t
+    {
+        plain = 0,              // 8 bytes per solution, random access
+        shared_prefix = 1,      // sequential access only
+        wide_rows = 2           // 4 bytes per column, any board size (see row_writer)
+    };
+
+    struct header
+    {
+        char magic[8];          // "QUEENS16"
+        uint32_t version;
+        uint32_t board_size;
+        uint64_t count;         // solutions in the file
+        encoding coding;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(header) == 32, "The solutions start on a 64-bit boundary.");
+
+    constexpr char magic[8] = { 'Q', 'U', 'E', 'E', 'N', 'S', '1', '6' };
+    constexpr uint32_t version = 1;
+
+    inline uint64_t pack(const int* rows, int board_size)
+    {
+        uint64_t result = 0;
+        for (int column = 0; column < board_size; ++column)
+        {
+            result |= uint64_t(rows[column]) << (4 * column);
+        }
+        return result;
+    }
+
+    inline void unpack(uint64_t solution, int* rows, int board_size)
+    {
+        for (int column = 0; column < board_size; ++column)
+        {
+            rows[column] = int((solution >> (4 * column)) & 0xf);
+        }
+    }
+
+    // Mirror image: row r becomes row n - 1 - r, in every nibble at once. No nibble is above n - 1, so no borrows.
+    inline uint64_t mirror(uint64_t solution, int board_size)
+    {
+        const uint64_t nibbles = (board_size == 16) ? ~0ULL : ((1ULL << (4 * board_size)) - 1);
+        const uint64_t last_rows = (0x1111'1111'1111'1111ULL * uint64_t(board_size - 1)) & nibbles;
+        return last_rows - solution;
+    }
+
+    // Half board searches: the mirror image too, unless the first queen is in the middle row of an odd board.
+    inline bool has_distinct_mirror(uint64_t solution, int board_size)
+    {
+        return 2 * int(solution & 0xf) + 1 != board_size;
+    }
+
+    /// <summary>
+    /// Buffered writer. The count in the header is filled in by close() (or the destructor).
+    /// close() throws std::runtime_error if anything could not be written; the destructor only prints it.
+    /// Not thread safe: one writer per thread, or hand it whole blocks (see append, and async_output.h).
+    /// Compression, when asked for, happens a block at a time, on whichever thread writes the block.
+    /// </summary>
+    class writer
+    {
+        std::ofstream m_file;
+        std::vector<uint64_t> m_buffer;
+        uint64_t m_count = 0;
+        const int m_board_size;
+        const encoding m_coding;
+        std::vector<uint8_t> m_encoded;
+        std::unique_ptr<prefix::encoder> m_encoder;
+        void flush();
+        void write(const uint64_t* solutions, size_t count);
+    public:
+        // Throws std::runtime_error, before touching the file, for boards above 16x16, and if the file cannot be created.
+        writer(const std::string& path, int board_size, encoding coding = encoding::plain);
+        ~writer();
+        writer(const writer&) = delete;
+        writer& operator = (const writer&) = delete;
+
+        void add(uint64_t solution)
+        {
+            m_buffer.push_back(solution);
+            if (m_buffer.size() == m_buffer.capacity())
+            {
+                flush();
+            }
+        }
+        void add(const int* rows)
+        {
+            add(pack(rows, m_board_size));
+        }
+        void add_with_mirror(const int* rows)
+        {
+            const uint64_t solution = pack(rows, m_board_size);
+            add(solution);
+            if (has_distinct_mirror(solution, m_board_size))
+            {
+                add(mirror(solution, m_board_size));
+            }
+        }
+        void append(const uint64_t* solutions, size_t count);
+
+        int board_size() const { return m_board_size; }
+        uint64_t count() const { return m_count; }
+        void close();
+    };
+
+    /// <summary>
+    /// Writer for boards of any size: rows as they come, a buffer at a time, so that a solution never has to be
+    /// in memory whole. The count in the header is the number of whole solutions, filled in by close(), which throws
+    /// std::runtime_error if anything could not be written.
+    /// </summary>
+    class row_writer
+    {
+        std::ofstream m_file;
+        std::vector<uint32_t> m_buffer;
+        uint64_t m_rows = 0;
+        const uint32_t m_board_size;
+        void flush();
+    public:
+        // Throws std::runtime_error if the file cannot be created.
+        row_writer(const std::string& path, uint32_t board_size);
+        ~row_writer();
+        row_writer(const row_writer&) = delete;
+        row_writer& operator = (const row_writer&) = delete;
+
+        // The row of the queen in the next column.
+        void add(uint32_t row)
+        {
+            m_buffer.push_back(row);
+            if (m_buffer.size() == m_buffer.capacity())
+            {
+                flush();
+            }
+        }
+
+        uint32_t board_size() const { return m_board_size; }
+        uint64_t count() const { return m_rows / m_board_size; }
+        void close();
+    };
+
+    /// <summary>
+    /// Read only view of a whole file, mapped into memory: no copies, random access by index (plain files only).
+    /// </summary>
+    class mapped_solutions
+    {
+        const header* m_header = nullptr;
+        const uint64_t* m_solutions = nullptr;
+        const uint8_t* m_payload = nullptr;
+        size_t m_bytes = 0;
+        void* m_file = nullptr;     // Windows: file and mapping handles. Elsewhere, unused: the descriptor is closed right away.
+        void* m_mapping = nullptr;
+        void release();
+    public:
+        explicit mapped_solutions(const std::string& path); // throws std::runtime_error on a missing or malformed file
+        ~mapped_solutions();
+        mapped_solutions(const mapped_solutions&) = delete;
+        mapped_solutions& operator = (const mapped_solutions&) = delete;
+
+        int board_size() const { return int(m_header->board_size); }
+        uint64_t size() const { return m_header->count; }
+        encoding coding() const { return m_header->coding; }
+        const uint64_t* data() const { return m_solutions; } // plain files only
+        const uint32_t* rows() const { return reinterpret_cast<const uint32_t*>(m_payload); } // wide_rows files only, board_size() per solution
+        size_t payload_bytes() const { return m_bytes - sizeof(header); }
+
+        // Every solution, in file order, whatever the encoding. fn(uint64_t packed_solution).
+        // Boards up to 16x16: wide_rows files have no packed solutions, see rows().
+        template <typename Fn>
+        void for_each(Fn fn) const
+        {
+            if (coding() == encoding::wide_rows)
+            {
+                return;
+            }
+            if (coding() == encoding::plain)
+            {
+                for (uint64_t i = 0; i < size(); ++i)
+                {
+                    fn(m_solutions[i]);
+                }
+                return;
+            }
+            prefix::decoder decoder(m_payload, payload_bytes(), board_size(), size());
+            uint64_t solution;
+            while (decoder.next(solution))
+            {
+                fn(solution);
+            }
+        }
+
+        // Plain files only.
+        uint64_t packed_at(uint64_t index) const { return m_solutions[index]; }
+        std::vector<int> operator [] (uint64_t index) const
+        {
+            std::vector<int> rows(board_size());
+            unpack(m_solutions[index], rows.data(), board_size());
+            return rows;
+        }
+    };
+} // namespace packed
@@ -0,0 +1,100 @@
+#pragma once
+
+// solution_tables.h
+// Every solution of the small boards, 4x4 to 10x10, found by the compiler: the search below runs in constexpr
+// lambdas, like qns's masks and threats table, and the program only carries the result. Counting those boards, or
+// fetching their k-th solution, is a load from a table; nothing is searched at run time.
+// The 10x10 search takes a few million constexpr steps, more than MSVC allows by default: see /constexpr:steps in
+// the project's AdditionalOptions.
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace qnstable
+{
+    constexpr int first_board_size = 4;
+    constexpr int last_board_size = 10;
+
+    namespace detail
+    {
+        // Columns left to right, rows low to high: the solutions come out in lexicographic order, as ranked by
+        // ranking::solution_index. visit(rows) is called with the rows by column of each one.
+        template<typename Visit>
+        constexpr void search(int board_size, int column, uint32_t rows_taken, uint32_t down, uint32_t up, int8_t* rows, Visit& visit)
+        {
+            if (column == board_size)
+            {
+                visit(rows);
+                return;
+            }
+            const uint32_t all_rows = (1u << board_size) - 1;
+            // down and up hold the diagonals of the queens so far, moved on to this column.
+            for (uint32_t free_rows = ~(rows_taken | down | up) & all_rows; free_rows; free_rows &= free_rows - 1)
+            {
+                const uint32_t row_bit = free_rows & (0u - free_rows);
+                rows[column] = int8_t(std::countr_zero(row_bit));
+                search(board_size, column + 1, rows_taken | row_bit, ((down | row_bit) << 1) & all_rows, (up | row_bit) >> 1, rows, visit);
+            }
+        }
+
+        template<int board_size>
+        constexpr size_t count = [] {
+            int8_t rows[board_size] = {};
+            size_t found = 0;
+            auto visit = [&found](const int8_t*) { ++found; };
+            search(board_size, 0, 0, 0, 0, rows, visit);
+            return found;
+        }();
+
+        template<int board_size>
+        constexpr std::array<std::array<int8_t, board_size>, count<board_size>> solutions = [] {
+            std::array<std::array<int8_t, board_size>, count<board_size>> A = {};
+            int8_t rows[board_size] = {};
+            size_t found = 0;
+            auto visit = [&A, &found](const int8_t* solution) {
+                for (int column = 0; column < board_size; ++column)
+                {
+                    A[found][column] = solution[column];
+                }
+                ++found;
+            };
+            search(board_size, 0, 0, 0, 0, rows, visit);
+            return A;
+        }();
+    } // namespace detail
+
+    // The published totals: the tables are checked against them when they are built.
+    static_assert(detail::count<4> == 2 && detail::count<5> == 10 && detail::count<6> == 4 && detail::count<7> == 40);
+    static_assert(detail::count<8> == 92 && detail::count<9> == 352 && detail::count<10> == 724);
+
+    struct table
+    {
+        int board_size = 0;
+        size_t count = 0;
+        const int8_t* rows = nullptr; // count solutions, board_size rows each, one after the other
+
+        constexpr const int8_t* solution(size_t k) const { return rows + k * size_t(board_size); }
+    };
+
+    namespace detail
+    {
+        template<int board_size>
+        constexpr table make_table()
+        {
+            return table{ board_size, count<board_size>, solutions<board_size>[0].data() };
+        }
+    }
+
+    constexpr std::array<table, last_board_size - first_board_size + 1> tables = {
+        detail::make_table<4>(), detail::make_table<5>(), detail::make_table<6>(), detail::make_table<7>(),
+        detail::make_table<8>(), detail::make_table<9>(), detail::make_table<10>()
+    };
+
+    // nullptr outside [first_board_size, last_board_size].
+    constexpr const table* find(int board_size)
+    {
+        return (board_size < first_board_size || last_board_size < board_size) ? nullptr : &tables[board_size - first_board_size];
+    }
+}
@@ -0,0 +1,45 @@
+#include "transposition_table.h"
+
+namespace memo
+{
+    table::table(int log2_buckets) : m_buckets(size_t(1) << log2_buckets), m_log2_buckets(log2_buckets)
+    {
+    }
+
+    void table::clear()
+    {
+        for (bucket& b : m_buckets)
+        {
+            b = bucket();
+        }
+        m_stats = statistics();
+    }
+
+    void table::store(uint64_t key, uint64_t count, int columns_left)
+    {
+        ++m_stats.stores;
+        bucket& b = bucket_for(key);
+        entry* victim = nullptr;
+        int victim_columns_left = 0;
+        for (entry& e : b.entries)
+        {
+            if (e.key == 0)
+            {
+                victim = &e;
+                break; // for
+            }
+            const int e_columns_left = int(e.value >> count_bits);
+            if (!victim || e_columns_left < victim_columns_left)
+            {
+                victim = &e;
+                victim_columns_left = e_columns_left;
+            }
+        }
+        if (victim->key != 0)
+        {
+            ++m_stats.evictions;
+        }
+        victim->key = key;
+        victim->value = count | (uint64_t(columns_left) << count_bits);
+    }
+} // namespace memo
@@ -0,0 +1,67 @@
+#pragma once
+
+// transposition_table.h
+// Bounded cache of subtree counts, for the last few columns of a search: two different ways of filling the first
+// columns often leave the same rows and the same diagonals free for the rest. Four entries per 64 byte bucket,
+// one cache line per lookup. When a bucket is full, the entry with the fewest columns left goes: the cheapest to redo.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace memo
+{
+    class table
+    {
+    public:
+        struct statistics
+        {
+            uint64_t lookups = 0;
+            uint64_t hits = 0;
+            uint64_t stores = 0;
+            uint64_t evictions = 0;
+        };
+    private:
+        struct entry
+        {
+            uint64_t key = 0;       // 0: empty. The search never looks up the empty board.
+            uint64_t value = 0;     // count in the low 56 bits, columns left in the high 8
+        };
+        struct alignas(64) bucket
+        {
+            entry entries[4];
+        };
+        static constexpr int count_bits = 56;
+
+        std::vector<bucket> m_buckets;
+        int m_log2_buckets;
+        statistics m_stats;
+
+        bucket& bucket_for(uint64_t key)
+        {
+            return m_buckets[size_t((key * 0x9e3779b97f4a7c15ULL) >> (64 - m_log2_buckets))];
+        }
+    public:
+        explicit table(int log2_buckets = 16); // 4 MB
+        void clear();                           // entries and statistics
+        size_t bytes() const { return m_buckets.size() * sizeof(bucket); }
+        const statistics& stats() const { return m_stats; }
+
+        bool find(uint64_t key, uint64_t& count)
+        {
+            ++m_stats.lookups;
+            for (const entry& e : bucket_for(key).entries)
+            {
+                if (e.key == key)
+                {
+                    ++m_stats.hits;
+                    count = e.value & ((1ULL << count_bits) - 1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void store(uint64_t key, uint64_t count, int columns_left);
+    };
+} // namespace memo